@@ -0,0 +1,432 @@
+#include "diff_cache.hpp"
+#include "file_map.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace fs = std::filesystem;
+
+/*
+    file layout
+
+    [header] [records] [strings]
+
+    one record per diff node, each followed by its child list and then its next
+    sibling. strings are the keys a diff allocated itself (array indices), stored
+    as a u32 length and the bytes.
+*/
+
+struct jf_DiffCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t hash_a;
+    uint64_t hash_b;
+    uint32_t options;
+    uint32_t record_count;
+    uint64_t string_size;
+    uint64_t checksum; // jf_hash_bytes of records + strings
+};
+
+enum jf_DiffCacheSide {
+    JF_DIFF_CACHE_NONE,
+    JF_DIFF_CACHE_A,
+    JF_DIFF_CACHE_B,
+};
+
+enum jf_DiffCacheFlags {
+    JF_DIFF_CACHE_CHILD      = 1 << 0,
+    JF_DIFF_CACHE_NEXT       = 1 << 1,
+    JF_DIFF_CACHE_KEY_ENTRY  = 1 << 2, // key of the object entry holding node key_side / key
+    JF_DIFF_CACHE_KEY_STRING = 1 << 3, // key is the string at offset key
+    JF_DIFF_CACHE_KEY_B      = 1 << 4, // the entry key is on side b
+};
+
+struct jf_DiffCacheRecord {
+    uint8_t type;
+    uint8_t flags;
+    uint8_t side_a; // which version node_a points into
+    uint8_t side_b;
+    uint32_t node_a;
+    uint32_t node_b;
+    uint32_t key;
+};
+
+static std::string jf_diff_cache_path(const jf_DiffCache* cache, jf_DiffKey key) {
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx%016llx%08x" JF_DIFF_CACHE_EXT,
+        (unsigned long long) key.hash_a, (unsigned long long) key.hash_b, (unsigned) key.options);
+
+    return (fs::path(cache->folder) / name).string();
+}
+
+jf_Error jf_diff_cache_open(jf_DiffCache** cache, const char* folder, uint64_t max_bytes) {
+    if (!cache || !folder) { return JF_NO_REF; }
+
+    std::error_code ec;
+    fs::create_directories(folder, ec);
+    if (ec) { return JF_INVALID_FILE_PATH; }
+
+    jf_DiffCache* c = (jf_DiffCache*) jf_calloc(1, sizeof(jf_DiffCache));
+    if (!c) { return JF_NO_MEM; }
+
+    size_t len = strlen(folder);
+    c->folder = (char*) jf_alloc(len + 1);
+    if (!c->folder) {
+        jf_free(c);
+        return JF_NO_MEM;
+    }
+
+    memcpy(c->folder, folder, len + 1);
+    c->max_bytes = max_bytes;
+
+    *cache = c;
+    return JF_SUCCESS;
+}
+
+jf_Error jf_diff_cache_close(jf_DiffCache* cache) {
+    if (!cache) { return JF_NO_REF; }
+
+    jf_free(cache->folder);
+    jf_free(cache);
+
+    return JF_SUCCESS;
+}
+
+/*
+    storing
+*/
+
+struct jf_DiffCacheWriter {
+    std::unordered_map<const jf_Node*, uint32_t> nodes[2];
+    std::unordered_map<const jf_String*, std::pair<int, uint32_t>> keys;
+    std::vector<jf_DiffCacheRecord> records;
+    std::string strings;
+
+    void index(const jf_Node* node, int side) {
+        uint32_t at = (uint32_t) nodes[side].size();
+        nodes[side].emplace(node, at);
+
+        if (node->type == JF_OBJECT) {
+            // objects sharing a shape share its keys, any entry holding the key stands in for it
+            const jf_Object* obj = node->o_value;
+            for (size_t i = 0; i < obj->used; ++i) {
+                keys.emplace(&obj->shape->keys[i], std::make_pair(side, (uint32_t) nodes[side].size()));
+                index(obj->values[i], side);
+            }
+        } else if (node->type == JF_ARRAY) {
+            for (size_t i = 0; i < node->a_value->used; ++i) {
+                index(node->a_value->elements[i], side);
+            }
+        }
+    }
+
+    bool node(const jf_Node* node, uint8_t* side, uint32_t* at) {
+        *side = JF_DIFF_CACHE_NONE;
+        *at = 0;
+        if (!node) { return true; }
+
+        for (int s = 0; s < 2; ++s) {
+            auto found = nodes[s].find(node);
+            if (found == nodes[s].end()) { continue; }
+
+            *side = (uint8_t) (s + 1);
+            *at = found->second;
+            return true;
+        }
+
+        return false;
+    }
+
+    // every sibling in a loop, children recurse, which keeps the depth to that of the json
+    bool list(const jf_DiffNode* diff) {
+        for (; diff; diff = diff->next) {
+            jf_DiffCacheRecord record;
+            memset(&record, 0, sizeof(record));
+
+            record.type = (uint8_t) diff->type;
+            if (!node(diff->node_a, &record.side_a, &record.node_a)) { return false; }
+            if (!node(diff->node_b, &record.side_b, &record.node_b)) { return false; }
+
+            if (diff->key) {
+                auto found = keys.find(diff->key);
+
+                if (found != keys.end() && !diff->key_allocated) {
+                    record.flags |= JF_DIFF_CACHE_KEY_ENTRY | (found->second.first ? JF_DIFF_CACHE_KEY_B : 0);
+                    record.key = found->second.second;
+                } else {
+                    uint32_t len = (uint32_t) diff->key->len;
+                    record.flags |= JF_DIFF_CACHE_KEY_STRING;
+                    record.key = (uint32_t) strings.size();
+
+                    strings.append((const char*) &len, sizeof(len));
+                    if (len) { strings.append(jf_string_data(diff->key), len); }
+                }
+            }
+
+            if (diff->child) { record.flags |= JF_DIFF_CACHE_CHILD; }
+            if (diff->next)  { record.flags |= JF_DIFF_CACHE_NEXT; }
+
+            records.push_back(record);
+            if (diff->child && !list(diff->child)) { return false; }
+        }
+
+        return true;
+    }
+};
+
+jf_Error jf_diff_cache_store(const jf_DiffCache* cache, jf_DiffKey key, const jf_DiffNode* diff, const jf_Node* a, const jf_Node* b) {
+    if (!cache || !diff || !a) { return JF_NO_REF; }
+
+    jf_DiffCacheWriter writer;
+    writer.index(a, 0);
+    if (b) { writer.index(b, 1); }
+
+    // something pointing outside both versions, can't be stored as indices
+    if (!writer.list(diff)) { return JF_INVALID_TYPE; }
+
+    if (writer.records.size() > UINT32_MAX || writer.strings.size() > UINT32_MAX) { return JF_INDEX_OUT_OF_BOUNDS; }
+
+    std::string body;
+    body.append((const char*) writer.records.data(), writer.records.size() * sizeof(jf_DiffCacheRecord));
+    body.append(writer.strings);
+
+    jf_DiffCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic        = JF_DIFF_CACHE_MAGIC;
+    header.version      = JF_DIFF_CACHE_VERSION;
+    header.hash_a       = key.hash_a;
+    header.hash_b       = key.hash_b;
+    header.options      = key.options;
+    header.record_count = (uint32_t) writer.records.size();
+    header.string_size  = writer.strings.size();
+    header.checksum     = jf_hash_bytes(body.data(), body.size());
+
+    // written aside and renamed in, a reader never sees half a diff
+    std::string path = jf_diff_cache_path(cache, key);
+    std::string temp_path = path + ".tmp";
+
+    FILE* f = fopen(temp_path.c_str(), "wb");
+    if (!f) { return JF_INVALID_FILE_PATH; }
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+           && fwrite(body.data(), 1, body.size(), f) == body.size();
+    ok = (fclose(f) == 0) && ok;
+
+    std::error_code ec;
+    if (ok) { fs::rename(temp_path, path, ec); }
+
+    if (!ok || ec) {
+        fs::remove(temp_path, ec);
+        return JF_IO_ERROR;
+    }
+
+    return JF_SUCCESS;
+}
+
+/*
+    loading
+*/
+
+struct jf_DiffCacheReader {
+    std::vector<jf_Node*> nodes[2];
+    std::vector<jf_String*> keys[2]; // key of the entry holding each node, NULL for roots and array elements
+
+    const jf_DiffCacheRecord* records;
+    size_t count;
+    size_t at;
+
+    const char* strings;
+    size_t string_size;
+
+    void index(jf_Node* node, int side, jf_String* key) {
+        nodes[side].push_back(node);
+        keys[side].push_back(key);
+
+        if (node->type == JF_OBJECT) {
+            jf_Object* obj = node->o_value;
+            for (size_t i = 0; i < obj->used; ++i) {
+                index(obj->values[i], side, &obj->shape->keys[i]);
+            }
+        } else if (node->type == JF_ARRAY) {
+            for (size_t i = 0; i < node->a_value->used; ++i) {
+                index(node->a_value->elements[i], side, NULL);
+            }
+        }
+    }
+
+    bool node(uint8_t side, uint32_t index, jf_Node** out) {
+        if (side == JF_DIFF_CACHE_NONE) {
+            *out = NULL;
+            return true;
+        }
+
+        if (side > JF_DIFF_CACHE_B || index >= nodes[side - 1].size()) { return false; }
+
+        *out = nodes[side - 1][index];
+        return true;
+    }
+
+    jf_Error key(const jf_DiffCacheRecord* record, jf_DiffNode* diff) {
+        if (record->flags & JF_DIFF_CACHE_KEY_ENTRY) {
+            int side = (record->flags & JF_DIFF_CACHE_KEY_B) ? 1 : 0;
+            if (record->key >= keys[side].size() || !keys[side][record->key]) { return JF_INVALID_SYNTAX; }
+
+            diff->key = keys[side][record->key];
+            return JF_SUCCESS;
+        }
+
+        if (record->flags & JF_DIFF_CACHE_KEY_STRING) {
+            uint32_t len;
+            if (record->key > string_size || string_size - record->key < sizeof(len)) { return JF_INVALID_SYNTAX; }
+
+            memcpy(&len, strings + record->key, sizeof(len));
+            if (len > string_size - record->key - sizeof(len)) { return JF_INVALID_SYNTAX; }
+
+            jf_Error err;
+            if (err = jf_diff_alloc_key(diff)) { return err; }
+            return jf_string_alloc(diff->key, strings + record->key + sizeof(len), len);
+        }
+
+        return JF_SUCCESS;
+    }
+
+    // nodes are linked in as soon as they exist, so a failure part way frees through the head
+    jf_Error list(jf_DiffNode** head) {
+        jf_DiffNode** link = head;
+
+        while (true) {
+            if (at >= count) { return JF_UNEXPECTED_EOF; }
+
+            jf_Error err;
+            jf_DiffCacheRecord record;
+            memcpy(&record, &records[at++], sizeof(record));
+
+            jf_DiffNode* diff = NULL;
+            if (err = jf_diff_alloc(&diff, NULL, NULL)) { return err; }
+            *link = diff;
+
+            if (record.type > JF_DIFF_UNKNOWN)                 { return JF_INVALID_SYNTAX; }
+            if (!node(record.side_a, record.node_a, &diff->node_a)) { return JF_INVALID_SYNTAX; }
+            if (!node(record.side_b, record.node_b, &diff->node_b)) { return JF_INVALID_SYNTAX; }
+
+            diff->type = (jf_TreeDiff) record.type;
+            if (err = key(&record, diff)) { return err; }
+
+            if (record.flags & JF_DIFF_CACHE_CHILD) {
+                if (err = list(&diff->child)) { return err; }
+            }
+
+            if (!(record.flags & JF_DIFF_CACHE_NEXT)) { return JF_SUCCESS; }
+            link = &diff->next;
+        }
+    }
+};
+
+jf_Error jf_diff_cache_load(const jf_DiffCache* cache, jf_DiffKey key, jf_Node* a, jf_Node* b, jf_DiffNode** diff) {
+    if (!cache || !a || !diff) { return JF_NO_REF; }
+
+    jf_Error err;
+    jf_FileMap map;
+    std::string path = jf_diff_cache_path(cache, key);
+
+    if (err = jf_file_map_open(&map, path.c_str())) { return err; }
+
+    jf_DiffCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    if (map.size >= sizeof(header)) { memcpy(&header, map.data, sizeof(header)); }
+
+    size_t body_size = map.size - JF_MATH_MIN(map.size, sizeof(header));
+    size_t records_size = (size_t) header.record_count * sizeof(jf_DiffCacheRecord);
+
+    bool valid = header.magic == JF_DIFF_CACHE_MAGIC
+              && header.version == JF_DIFF_CACHE_VERSION
+              && header.hash_a == key.hash_a
+              && header.hash_b == key.hash_b
+              && header.options == key.options
+              && records_size <= body_size
+              && header.string_size == body_size - records_size
+              && header.checksum == jf_hash_bytes(map.data + sizeof(header), body_size);
+
+    if (!valid) {
+        jf_file_map_close(&map);
+        return JF_INVALID_SYNTAX;
+    }
+
+    jf_DiffCacheReader reader;
+    reader.records     = (const jf_DiffCacheRecord*) (map.data + sizeof(header));
+    reader.count       = header.record_count;
+    reader.at          = 0;
+    reader.strings     = map.data + sizeof(header) + records_size;
+    reader.string_size = (size_t) header.string_size;
+
+    reader.index(a, 0, NULL);
+    if (b) { reader.index(b, 1, NULL); }
+
+    jf_DiffNode* head = NULL;
+    err = reader.list(&head);
+    if (!err && reader.at != reader.count) { err = JF_INVALID_SYNTAX; }
+
+    jf_file_map_close(&map);
+
+    if (err) {
+        if (head) { jf_diff_free(head); }
+        return err;
+    }
+
+    // a hit counts as a use for the lru order
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+
+    *diff = head;
+    return JF_SUCCESS;
+}
+
+jf_Error jf_diff_cache_trim(const jf_DiffCache* cache) {
+    if (!cache) { return JF_NO_REF; }
+
+    struct Entry {
+        fs::file_time_type used;
+        uint64_t size;
+        fs::path path;
+    };
+
+    std::error_code ec;
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+
+    for (const auto& entry : fs::directory_iterator(cache->folder, ec)) {
+        std::error_code entry_ec;
+        if (!entry.is_regular_file(entry_ec) || entry.path().extension() != JF_DIFF_CACHE_EXT) { continue; }
+
+        Entry e = { entry.last_write_time(entry_ec), entry.file_size(entry_ec), entry.path() };
+        if (entry_ec) { continue; }
+
+        total += e.size;
+        entries.push_back(std::move(e));
+    }
+
+    if (ec) { return JF_INVALID_FILE_PATH; }
+    if (total <= cache->max_bytes) { return JF_SUCCESS; }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& x, const Entry& y) { return x.used < y.used; });
+
+    size_t removed = 0;
+    for (const Entry& e : entries) {
+        if (total <= cache->max_bytes) { break; }
+
+        if (fs::remove(e.path, ec)) {
+            total -= e.size;
+            removed++;
+        }
+    }
+
+    JF_DEBUG_LOG("dropped %zu diffs from the cache", removed);
+    return JF_SUCCESS;
+}
@@ -0,0 +1,48 @@
+#ifndef _DIFF_CACHE_HPP
+#define _DIFF_CACHE_HPP
+
+#include "jf.h"
+#include <stdint.h>
+
+/*
+    diff cache - diffs between two versions, kept on disk so reopening a timeline doesn't redo them
+
+    versions never change, so a diff is keyed by the jf_node_hash of both sides. one
+    file per diff in the cache folder, read only when that diff is asked for. hits
+    touch the file, trimming drops the least recently used ones until the folder
+    fits max_bytes again.
+
+    a diff is stored as its tree in pre order. node and key pointers become indices
+    into the pre order of the side they point into, so they can be pointed at the
+    matching nodes of whichever copy of the versions is loaded.
+*/
+
+#define JF_DIFF_CACHE_MAGIC   0x4344464a // "JFDC"
+#define JF_DIFF_CACHE_VERSION 3          // bump whenever jf_compare_object_diff changes what it builds
+#define JF_DIFF_CACHE_EXT     ".jfd"
+
+struct jf_DiffKey {
+    uint64_t hash_a;  // jf_node_hash of the older version
+    uint64_t hash_b;  // jf_node_hash of the newer one, 0 for the first version's diff against nothing
+    uint32_t options; // diff options, none exist yet but they are part of the key for when they do
+};
+
+struct jf_DiffCache {
+    char* folder;
+    uint64_t max_bytes;
+};
+
+// creates the folder if it isn't there yet
+jf_Error jf_diff_cache_open(jf_DiffCache** cache, const char* folder, uint64_t max_bytes);
+
+jf_Error jf_diff_cache_close(jf_DiffCache* cache);
+
+// the diff of a against b as jf_compare_object_diff would build it, JF_INVALID_FILE_PATH on a miss
+jf_Error jf_diff_cache_load(const jf_DiffCache* cache, jf_DiffKey key, jf_Node* a, jf_Node* b, jf_DiffNode** diff);
+
+jf_Error jf_diff_cache_store(const jf_DiffCache* cache, jf_DiffKey key, const jf_DiffNode* diff, const jf_Node* a, const jf_Node* b);
+
+// drops the least recently used diffs until the cache fits max_bytes
+jf_Error jf_diff_cache_trim(const jf_DiffCache* cache);
+
+#endif
@@ -0,0 +1,260 @@
+#include "file_map.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string.h>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <windows.h>
+#   include <io.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#endif
+
+static void jf_file_map_reset(jf_FileMap* map) {
+    map->data   = NULL;
+    map->size   = 0;
+    map->handle = NULL;
+    map->mapped = JF_FALSE;
+}
+
+// fallback for platforms (or files) that can't be mapped
+static jf_Error jf_file_map_read(jf_FileMap* map, const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { return JF_INVALID_FILE_PATH; }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+
+    if (size < 0) {
+        fclose(f);
+        return JF_INVALID_FILE_PATH;
+    }
+
+    char* buffer = (char*) jf_alloc(size + 1);
+    if (!buffer) {
+        fclose(f);
+        return JF_NO_MEM;
+    }
+
+    size_t read = fread(buffer, 1, size, f);
+    buffer[read] = '\0';
+    fclose(f);
+
+    map->data   = buffer;
+    map->size   = read;
+    map->handle = buffer;
+    map->mapped = JF_FALSE;
+
+    return JF_SUCCESS;
+}
+
+jf_Error jf_file_map_open(jf_FileMap* map, const char* path) {
+    if (!map || !path) { return JF_NO_REF; }
+    jf_file_map_reset(map);
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) { return JF_INVALID_FILE_PATH; }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return JF_INVALID_FILE_PATH;
+    }
+
+    // empty files can't be mapped, but they are still valid
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return JF_SUCCESS;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) { return jf_file_map_read(map, path); }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        return jf_file_map_read(map, path);
+    }
+
+    map->data   = (const char*) view;
+    map->size   = (size_t) size.QuadPart;
+    map->handle = mapping;
+    map->mapped = JF_TRUE;
+
+    return JF_SUCCESS;
+#elif defined(__unix__) || defined(__APPLE__)
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return JF_INVALID_FILE_PATH; }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return JF_INVALID_FILE_PATH;
+    }
+
+    if (st.st_size == 0) {
+        close(fd);
+        return JF_SUCCESS;
+    }
+
+    void* view = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) { return jf_file_map_read(map, path); }
+
+    map->data   = (const char*) view;
+    map->size   = (size_t) st.st_size;
+    map->handle = NULL;
+    map->mapped = JF_TRUE;
+
+    return JF_SUCCESS;
+#else
+    return jf_file_map_read(map, path);
+#endif
+}
+
+jf_Error jf_file_read(jf_FileMap* map, const char* path) {
+    if (!map || !path) { return JF_NO_REF; }
+    jf_file_map_reset(map);
+
+    return jf_file_map_read(map, path);
+}
+
+jf_Error jf_file_map_close(jf_FileMap* map) {
+    if (!map) { return JF_NO_REF; }
+
+    if (!map->mapped) {
+        if (map->handle) { jf_free(map->handle); }
+        jf_file_map_reset(map);
+        return JF_SUCCESS;
+    }
+
+#if defined(_WIN32)
+    UnmapViewOfFile(map->data);
+    CloseHandle((HANDLE) map->handle);
+#elif defined(__unix__) || defined(__APPLE__)
+    munmap((void*) map->data, map->size);
+#endif
+
+    jf_file_map_reset(map);
+    return JF_SUCCESS;
+}
+
+jf_Error jf_file_map_prefetch(const jf_FileMap* map, size_t offset, size_t size) {
+    if (!map) { return JF_NO_REF; }
+    if (!map->mapped || offset >= map->size) { return JF_SUCCESS; }
+
+    if (size > map->size - offset) { size = map->size - offset; }
+
+#if defined(_WIN32) && _WIN32_WINNT >= 0x0602
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = (PVOID) (map->data + offset);
+    range.NumberOfBytes  = size;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#elif defined(__unix__) || defined(__APPLE__)
+    // madvise wants a page aligned start
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t start = offset & ~(page - 1);
+    madvise((void*) (map->data + start), size + (offset - start), MADV_WILLNEED);
+#endif
+
+    return JF_SUCCESS;
+}
+
+jf_Error jf_file_sync(const char* path) {
+    if (!path) { return JF_NO_REF; }
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) { return JF_INVALID_FILE_PATH; }
+
+    BOOL ok = FlushFileBuffers(file);
+    CloseHandle(file);
+
+    return ok ? JF_SUCCESS : JF_IO_ERROR;
+#elif defined(__unix__) || defined(__APPLE__)
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return JF_INVALID_FILE_PATH; }
+
+    int res = fsync(fd);
+    close(fd);
+
+    return res == 0 ? JF_SUCCESS : JF_IO_ERROR;
+#else
+    return JF_SUCCESS;
+#endif
+}
+
+jf_Error jf_file_replace(const char* path, const char* data, size_t size) {
+    if (!path || (!data && size)) { return JF_NO_REF; }
+
+    // a symlinked config keeps its link, the file it points to is the one replaced
+    std::error_code ec;
+    std::string target = std::filesystem::canonical(path, ec).string();
+    if (!ec) { path = target.c_str(); }
+
+    // same folder as path, a rename never crosses filesystems
+    size_t path_len = strlen(path);
+    char* temp_path = (char*) jf_alloc(path_len + sizeof(JF_FILE_REPLACE_EXT));
+    if (!temp_path) { return JF_NO_MEM; }
+
+    memcpy(temp_path, path, path_len);
+    memcpy(temp_path + path_len, JF_FILE_REPLACE_EXT, sizeof(JF_FILE_REPLACE_EXT));
+
+    FILE* f = fopen(temp_path, "wb");
+    if (!f) {
+        jf_free(temp_path);
+        return JF_INVALID_FILE_PATH;
+    }
+
+    jf_Bool ok = (jf_Bool) (fwrite(data, 1, size, f) == size && fflush(f) == 0);
+
+#if defined(_WIN32)
+    ok = (jf_Bool) (ok && _commit(_fileno(f)) == 0);
+#elif defined(__unix__) || defined(__APPLE__)
+    // the copy keeps the permissions of the file it replaces
+    struct stat st;
+    if (ok && stat(path, &st) == 0) { ok = (jf_Bool) (fchmod(fileno(f), st.st_mode & 07777) == 0); }
+
+    ok = (jf_Bool) (ok && fsync(fileno(f)) == 0);
+#endif
+
+    ok = (jf_Bool) (fclose(f) == 0 && ok);
+
+#if defined(_WIN32)
+    ok = (jf_Bool) (ok && MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH));
+#else
+    ok = (jf_Bool) (ok && rename(temp_path, path) == 0);
+
+    // the rename only survives a power loss once the folder holding it is synced
+    if (ok) {
+        std::string folder = std::filesystem::path(path).parent_path().string();
+        ok = (jf_Bool) (jf_file_sync(folder.empty() ? "." : folder.c_str()) == JF_SUCCESS);
+    }
+#endif
+
+    if (!ok) { remove(temp_path); }
+    jf_free(temp_path);
+
+    return ok ? JF_SUCCESS : JF_IO_ERROR;
+}
+
+jf_Error jf_hash_file(const char* path, uint64_t* hash) {
+    if (!path || !hash) { return JF_NO_REF; }
+
+    jf_Error err;
+    jf_FileMap map;
+
+    if (err = jf_file_read(&map, path)) { return err; }
+
+    *hash = jf_hash_bytes(map.data, map.size);
+    return jf_file_map_close(&map);
+}
@@ -0,0 +1,45 @@
+#ifndef _FILE_MAP_HPP
+#define _FILE_MAP_HPP
+
+#include "jf.h"
+
+/*
+    read only view of an entire file
+    mmap'd where the platform allows it, otherwise read into a heap buffer
+
+    only the app's own files (packs, snapshots, the diff cache) are mapped. a mapping of
+    a file another process truncates faults (SIGBUS) on the next read, so tracked source
+    files always go through jf_file_read.
+*/
+struct jf_FileMap {
+    const char* data;
+    size_t size;
+
+    void* handle;   // platform mapping handle, or the heap buffer
+    jf_Bool mapped; // JF_TRUE if data is a mapping rather than a copy
+};
+
+jf_Error jf_file_map_open(jf_FileMap* map, const char* path);
+
+// never a mapping, a heap copy taken with plain reads
+jf_Error jf_file_read(jf_FileMap* map, const char* path);
+
+jf_Error jf_file_map_close(jf_FileMap* map);
+
+// asks the kernel to start reading a range of the mapping in the background, a hint only
+jf_Error jf_file_map_prefetch(const jf_FileMap* map, size_t offset, size_t size);
+
+// flushes a file's data to the disk
+jf_Error jf_file_sync(const char* path);
+
+#define JF_FILE_REPLACE_EXT ".jftmp"
+
+// writes data to a temporary file next to path and renames it over path, so readers
+// of path only ever see the old contents or the new ones, never a partial write. a symlink
+// at path is followed, the file it points to is replaced and the link stays
+jf_Error jf_file_replace(const char* path, const char* data, size_t size);
+
+// jf_hash_bytes over the file's contents, read rather than mapped
+jf_Error jf_hash_file(const char* path, uint64_t* hash);
+
+#endif
@@ -0,0 +1,439 @@
+#include "file_watch.hpp"
+#include "jf.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#if defined(__linux__)
+#   include <errno.h>
+#   include <unistd.h>
+#   include <sys/inotify.h>
+#   include <sys/vfs.h>
+#   define FILE_WATCH_NOTIFY_MASK (IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF)
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#   include <sys/stat.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static bool is_json_path(const fs::path& path) {
+    return path.extension() == ".json";
+}
+
+static bool read_fingerprint(const std::string& path, FileFingerprint& fingerprint, bool& directory) {
+#if defined(__unix__) || defined(__APPLE__)
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) { return false; }
+
+    directory = S_ISDIR(st.st_mode);
+#   if defined(__APPLE__)
+    fingerprint.mtime = (int64_t) st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#   else
+    fingerprint.mtime = (int64_t) st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#   endif
+    fingerprint.size  = directory ? 0 : (uint64_t) st.st_size;
+    fingerprint.inode = (uint64_t) st.st_ino;
+
+    return true;
+#else
+    std::error_code ec;
+    fs::file_status status = fs::status(path, ec);
+    if (ec || !fs::exists(status)) { return false; }
+
+    directory = fs::is_directory(status);
+    fingerprint.mtime = (int64_t) fs::last_write_time(path, ec).time_since_epoch().count();
+    fingerprint.size  = directory ? 0 : (uint64_t) fs::file_size(path, ec);
+    fingerprint.inode = 0;
+
+    return !ec;
+#endif
+}
+
+// filesystems where inotify misses changes made by other hosts or layers
+static bool notify_unreliable(const std::string& folder) {
+#if defined(__linux__)
+    struct statfs st;
+    if (statfs(folder.c_str(), &st) != 0) { return false; }
+
+    switch ((uint32_t) st.f_type) {
+        case 0x00006969: // nfs
+        case 0x0000517b: // smbfs
+        case 0xff534d42: // cifs
+        case 0xfe534d42: // smb2
+        case 0x65735546: // fuse
+        case 0x794c7630: // overlayfs
+            return true;
+    }
+#endif
+
+    return false;
+}
+
+// what every path below folder starts with, siblings like "cfg.json" or "cfg-old" don't
+static std::string child_prefix(const std::string& folder) {
+    const char separator = (char) fs::path::preferred_separator;
+    if (!folder.empty() && (folder.back() == '/' || folder.back() == separator)) { return folder; }
+
+    return folder + separator;
+}
+
+static bool has_prefix(const std::string& path, const std::string& prefix) {
+    return path.compare(0, prefix.size(), prefix) == 0;
+}
+
+bool FileWatch::open(const std::string& folder) {
+    close();
+
+    std::error_code ec;
+    if (folder.empty() || !fs::is_directory(folder, ec)) { return false; }
+
+    root = folder;
+
+    if (!force_polling && !notify_unreliable(root) && notify_open()) {
+        JF_LOG("watching %s with inotify", root.c_str());
+        return true;
+    }
+
+    // baseline for polling, nothing is reported for files that already exist
+    FileFingerprint fingerprint;
+    bool directory = true;
+    TimePoint now = std::chrono::steady_clock::now();
+
+    read_fingerprint(root, fingerprint, directory);
+    poll_add(root, fingerprint, true, max_interval, now + max_interval);
+    poll_list(root, NULL, now);
+
+    JF_LOG("watching %s by polling %zu entries", root.c_str(), poll_paths.size());
+    return true;
+}
+
+void FileWatch::close() {
+#if defined(__linux__)
+    if (notify_fd >= 0) { ::close(notify_fd); }
+#endif
+
+    notify_fd = -1;
+    watch_dirs.clear();
+    poll_entries.clear();
+    poll_free.clear();
+    poll_paths.clear();
+    poll_queue = {};
+    root.clear();
+}
+
+void FileWatch::poll(std::vector<FileWatchEvent>& events) {
+    if (!is_open()) { return; }
+
+    bool rescan = false;
+    std::map<std::string, FileWatchEventType> changes;
+
+    if (native()) {
+        if (!notify_poll(changes, rescan)) {
+            // a folder went unwatched, polling is the only way to keep seeing it
+            JF_LOG("inotify is out of watches, polling %s instead", root.c_str());
+
+            std::string folder = root;
+            bool polling = force_polling;
+
+            force_polling = true;
+            open(folder);
+            force_polling = polling;
+            rescan = true;
+        }
+    } else {
+        poll_scheduled(changes);
+    }
+
+    if (rescan) {
+        events.push_back({ FILE_WATCH_RESCAN, root });
+    }
+
+    for (auto& [path, type] : changes) {
+        events.push_back({ type, path });
+    }
+}
+
+/*
+    inotify backend
+*/
+
+bool FileWatch::notify_open() {
+#if defined(__linux__)
+    notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (notify_fd < 0) { return false; }
+
+    if (!notify_add_tree(root, NULL)) {
+        ::close(notify_fd);
+        notify_fd = -1;
+        watch_dirs.clear();
+        return false;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+// inotify is not recursive, every folder in the tree needs its own watch
+bool FileWatch::notify_add_tree(const std::string& folder, std::map<std::string, FileWatchEventType>* found) {
+#if defined(__linux__)
+    std::error_code ec;
+
+    int wd = inotify_add_watch(notify_fd, folder.c_str(), FILE_WATCH_NOTIFY_MASK);
+    if (wd < 0) { return false; }
+    watch_dirs[wd] = folder;
+
+    for (auto it = fs::recursive_directory_iterator(folder, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        const std::string path = it->path().string();
+
+        if (it->is_directory(ec)) {
+            wd = inotify_add_watch(notify_fd, path.c_str(), FILE_WATCH_NOTIFY_MASK);
+            if (wd < 0) { return false; }
+            watch_dirs[wd] = path;
+            continue;
+        }
+
+        // files that landed in a new folder before its watch existed
+        if (found && it->is_regular_file(ec) && is_json_path(it->path())) {
+            (*found)[path] = FILE_WATCH_CHANGED;
+        }
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+// drops the watches of a folder and everything below it
+void FileWatch::notify_remove_tree(const std::string& folder) {
+#if defined(__linux__)
+    const std::string prefix = child_prefix(folder);
+
+    for (auto it = watch_dirs.begin(); it != watch_dirs.end(); ) {
+        if (it->second != folder && !has_prefix(it->second, prefix)) {
+            ++it;
+            continue;
+        }
+
+        inotify_rm_watch(notify_fd, it->first);
+        it = watch_dirs.erase(it);
+    }
+#endif
+}
+
+// false when a new folder couldn't get a watch because inotify ran out of them
+bool FileWatch::notify_poll(std::map<std::string, FileWatchEventType>& changes, bool& rescan) {
+    bool watched = true;
+
+#if defined(__linux__)
+    alignas(struct inotify_event) char buffer[0x10000];
+
+    for (;;) {
+        ssize_t len = read(notify_fd, buffer, sizeof(buffer));
+        if (len <= 0) { break; }
+
+        for (char* ptr = buffer; ptr < buffer + len; ) {
+            const struct inotify_event* event = (const struct inotify_event*) ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                rescan = true;
+                continue;
+            }
+
+            auto dir = watch_dirs.find(event->wd);
+            if (dir == watch_dirs.end()) { continue; }
+
+            if (event->mask & (IN_IGNORED | IN_DELETE_SELF)) {
+                if (event->mask & IN_IGNORED) { watch_dirs.erase(dir); }
+                continue;
+            }
+
+            if (event->len == 0) { continue; }
+
+            fs::path path = fs::path(dir->second) / event->name;
+
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    if (!notify_add_tree(path.string(), &changes)) {
+                        rescan = true;
+
+                        // anything else means the folder is already gone again
+                        if (errno == ENOSPC || errno == ENOMEM) { watched = false; }
+                    }
+                }
+
+                // a folder moved out of the tree takes its files with it, and its watches would keep
+                // reporting them under paths that are gone. a move within the tree re-adds them on IN_MOVED_TO
+                if (event->mask & IN_MOVED_FROM) {
+                    notify_remove_tree(path.string());
+                    rescan = true;
+                }
+                continue;
+            }
+
+            if (!is_json_path(path)) { continue; }
+
+            if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                changes[path.string()] = FILE_WATCH_REMOVED;
+            } else {
+                changes[path.string()] = FILE_WATCH_CHANGED;
+            }
+        }
+    }
+#endif
+
+    return watched;
+}
+
+/*
+    polling backend
+
+    every file and folder has a stat fingerprint and a due time, each poll stats
+    whatever is due until the time budget runs out. a file is only reported when its
+    fingerprint moved, folders are only listed when theirs did. entries that keep
+    changing are checked every min_interval, quiet ones back off to max_interval.
+*/
+
+void FileWatch::poll_add(const std::string& path, const FileFingerprint& fingerprint, bool directory, std::chrono::milliseconds interval, TimePoint due) {
+    size_t slot = poll_entries.size();
+    if (!poll_free.empty()) {
+        slot = poll_free.back();
+        poll_free.pop_back();
+    } else {
+        poll_entries.emplace_back();
+    }
+
+    PollEntry& entry = poll_entries[slot];
+    entry.path        = path;
+    entry.fingerprint = fingerprint;
+    entry.directory   = directory;
+    entry.interval    = interval;
+    entry.due         = due;
+    entry.live        = true;
+
+    poll_paths[path] = slot;
+    poll_queue.push({ due, slot });
+}
+
+// picks up new children of a folder, found is NULL while building the baseline
+void FileWatch::poll_list(const std::string& folder, std::map<std::string, FileWatchEventType>* found, TimePoint now) {
+    std::error_code ec;
+    std::unordered_set<std::string> listed;
+
+    for (auto it = fs::directory_iterator(folder, ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+        const std::string path = it->path().string();
+        listed.insert(path);
+
+        if (poll_paths.count(path)) { continue; }
+
+        FileFingerprint fingerprint;
+        bool directory = false;
+        if (!read_fingerprint(path, fingerprint, directory)) { continue; }
+        if (!directory && !is_json_path(it->path())) { continue; }
+
+        // new entries are likely to change again soon, the baseline is spread over a full interval
+        if (found) {
+            poll_add(path, fingerprint, directory, min_interval, now + min_interval);
+        } else {
+            int64_t slot = (int64_t) (poll_paths.size() % 64);
+            poll_add(path, fingerprint, directory, max_interval, now + min_interval + (max_interval - min_interval) * slot / 64);
+        }
+
+        if (directory) {
+            poll_list(path, found, now);
+        } else if (found) {
+            (*found)[path] = FILE_WATCH_CHANGED;
+        }
+    }
+
+    if (ec || !found) { return; }
+
+    // children that disappeared from the listing
+    const std::string prefix = child_prefix(folder);
+    std::vector<std::string> gone;
+
+    for (auto it = poll_paths.lower_bound(prefix); it != poll_paths.end() && has_prefix(it->first, prefix); ++it) {
+        if (it->first.find((char) fs::path::preferred_separator, prefix.size()) != std::string::npos) { continue; }
+        if (!listed.count(it->first)) { gone.push_back(it->first); }
+    }
+
+    for (const std::string& path : gone) {
+        poll_forget(path, *found);
+    }
+}
+
+// drops an entry and everything below it
+void FileWatch::poll_forget(const std::string& path, std::map<std::string, FileWatchEventType>& changes) {
+    const std::string prefix = child_prefix(path);
+
+    auto forget = [&](std::map<std::string, size_t>::iterator it) {
+        PollEntry& entry = poll_entries[it->second];
+        if (!entry.directory) { changes[it->first] = FILE_WATCH_REMOVED; }
+
+        entry.live = false;
+        entry.path.clear();
+        poll_free.push_back(it->second);
+
+        return poll_paths.erase(it);
+    };
+
+    auto it = poll_paths.find(path);
+    if (it != poll_paths.end()) { forget(it); }
+
+    for (it = poll_paths.lower_bound(prefix); it != poll_paths.end() && has_prefix(it->first, prefix); ) {
+        it = forget(it);
+    }
+}
+
+void FileWatch::poll_scheduled(std::map<std::string, FileWatchEventType>& changes) {
+    TimePoint now = std::chrono::steady_clock::now();
+    size_t polled = 0;
+
+    while (!poll_queue.empty()) {
+        if (poll_queue.top().first > now) { break; }
+
+        // checking the clock costs about as much as a stat, only do it every few entries
+        if ((++polled & 0x1f) == 0 && std::chrono::steady_clock::now() - now > poll_budget) { break; }
+
+        auto [due, slot] = poll_queue.top();
+        poll_queue.pop();
+
+        // stale queue entry, rescheduled or forgotten since
+        PollEntry& entry = poll_entries[slot];
+        if (!entry.live || entry.due != due) { continue; }
+
+        FileFingerprint fingerprint;
+        bool directory = false;
+
+        if (!read_fingerprint(entry.path, fingerprint, directory) || directory != entry.directory) {
+            poll_forget(std::string(entry.path), changes);
+            continue;
+        }
+
+        if (fingerprint != entry.fingerprint) {
+            entry.fingerprint = fingerprint;
+            entry.interval = min_interval;
+
+            if (entry.directory) {
+                // listing can grow poll_entries, don't hold on to the reference
+                std::string folder = entry.path;
+                entry.due = now + min_interval;
+                poll_queue.push({ entry.due, slot });
+                poll_list(folder, &changes, now);
+                continue;
+            }
+
+            changes[entry.path] = FILE_WATCH_CHANGED;
+        } else {
+            entry.interval = std::min(entry.interval * 2, max_interval);
+        }
+
+        entry.due = now + entry.interval;
+        poll_queue.push({ entry.due, slot });
+    }
+}
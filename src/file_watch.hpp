@@ -0,0 +1,98 @@
+#ifndef _FILE_WATCH_HPP
+#define _FILE_WATCH_HPP
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*
+    watches a folder tree for changes to .json files
+
+    uses inotify on linux, everywhere else (network mounts, overlays, or when inotify
+    runs out of watches) it falls back to polling stat fingerprints on a schedule
+*/
+
+enum FileWatchEventType {
+    FILE_WATCH_CHANGED, // created, written or moved into the tree
+    FILE_WATCH_REMOVED, // deleted or moved out of the tree
+    FILE_WATCH_RESCAN,  // events were lost, the whole tree needs checking
+};
+
+struct FileWatchEvent {
+    FileWatchEventType type;
+    std::string path;
+};
+
+// cheap identity of a file, compared before anything is read
+struct FileFingerprint {
+    int64_t  mtime = 0;
+    uint64_t size  = 0;
+    uint64_t inode = 0;
+
+    bool operator==(const FileFingerprint& o) const { return mtime == o.mtime && size == o.size && inode == o.inode; }
+    bool operator!=(const FileFingerprint& o) const { return !(*this == o); }
+};
+
+struct FileWatch {
+    std::string root = "";
+    bool force_polling = false;
+
+    // polling schedule, busy files are checked often and quiet ones back off to max_interval
+    std::chrono::milliseconds min_interval = std::chrono::milliseconds(250);
+    std::chrono::milliseconds max_interval = std::chrono::milliseconds(8000);
+    std::chrono::microseconds poll_budget  = std::chrono::microseconds(1000);
+
+    bool open(const std::string& folder);
+    void close();
+    bool is_open() const { return !root.empty(); }
+    bool native() const { return notify_fd >= 0; }
+
+    // non blocking, appends at most one event per path
+    void poll(std::vector<FileWatchEvent>& events);
+
+    FileWatch() = default;
+    FileWatch(const FileWatch&) = delete;
+    FileWatch& operator=(const FileWatch&) = delete;
+    ~FileWatch() { close(); }
+
+private:
+    int notify_fd = -1;
+    std::map<int, std::string> watch_dirs = {};
+
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    struct PollEntry {
+        std::string path;
+        FileFingerprint fingerprint;
+        std::chrono::milliseconds interval;
+        TimePoint due;
+        bool directory;
+        bool live;
+    };
+
+    // entries live in a flat slot array, the queue and path lookup refer to slots
+    std::vector<PollEntry> poll_entries = {};
+    std::vector<size_t> poll_free = {};
+    std::map<std::string, size_t> poll_paths = {};
+    std::priority_queue<
+        std::pair<TimePoint, size_t>,
+        std::vector<std::pair<TimePoint, size_t>>,
+        std::greater<std::pair<TimePoint, size_t>>
+    > poll_queue = {};
+
+    bool notify_open();
+    bool notify_add_tree(const std::string& folder, std::map<std::string, FileWatchEventType>* found);
+    void notify_remove_tree(const std::string& folder);
+    bool notify_poll(std::map<std::string, FileWatchEventType>& changes, bool& rescan);
+
+    void poll_add(const std::string& path, const FileFingerprint& fingerprint, bool directory, std::chrono::milliseconds interval, TimePoint due);
+    void poll_list(const std::string& folder, std::map<std::string, FileWatchEventType>* found, TimePoint now);
+    void poll_forget(const std::string& folder, std::map<std::string, FileWatchEventType>& changes);
+    void poll_scheduled(std::map<std::string, FileWatchEventType>& changes);
+};
+
+#endif
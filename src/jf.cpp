@@ -3,81 +3,377 @@
 #include "memory.h"
 #include "string.h"
 #include "json_parse.hpp"
+#include "parallel.hpp"
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <unordered_map>
 
-int __jf_heap_count__ = 0; 
-int __jf_heap_count_alloc__ = 0; 
-int __jf_heap_count_free__ = 0;
+#ifdef JF_DEBUG_HEAP
+std::atomic<int> __jf_heap_count_alloc__(0);
+std::atomic<int> __jf_heap_count_free__(0);
+#endif
+
+/*
+    HASHING
+*/
+
+static const uint64_t jf_hash_secret[4] = {
+    0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+};
+
+#define JF_HASH_PRIME32 0x9e3779b1ull
+
+JF_INLINE uint64_t jf_hash_read8(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+JF_INLINE uint64_t jf_hash_read4(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+JF_INLINE uint64_t jf_hash_read3(const uint8_t* p, size_t len) {
+    return ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) | p[len - 1];
+}
+
+#if defined(_MSC_VER) && defined(_M_X64) && !defined(__SIZEOF_INT128__)
+#   include <intrin.h>
+#endif
+
+// 64x64 -> 128 multiply
+JF_INLINE void jf_hash_mul128(uint64_t a, uint64_t b, uint64_t* lo, uint64_t* hi) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t) a * b;
+    *lo = (uint64_t) r;
+    *hi = (uint64_t) (r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    *lo = _umul128(a, b, hi);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t) a, lb = (uint32_t) b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    *lo = t + (rm1 << 32);
+    c += *lo < t;
+    *hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+// 128 bit product folded back to 64 bits
+JF_INLINE uint64_t jf_hash_mum(uint64_t a, uint64_t b) {
+    uint64_t lo, hi;
+    jf_hash_mul128(a, b, &lo, &hi);
+    return lo ^ hi;
+}
+
+// plain wyhash, used on its own for short inputs and for the tail of long ones
+static uint64_t jf_hash_small(const uint8_t* p, size_t len, uint64_t seed) {
+    const uint64_t* s = jf_hash_secret;
+    uint64_t a, b;
+
+    seed ^= jf_hash_mum(seed ^ s[0], s[1]);
+
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (jf_hash_read4(p) << 32) | jf_hash_read4(p + ((len >> 3) << 2));
+            b = (jf_hash_read4(p + len - 4) << 32) | jf_hash_read4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = jf_hash_read3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = jf_hash_mum(jf_hash_read8(p)      ^ s[1], jf_hash_read8(p + 8)  ^ seed);
+                see1 = jf_hash_mum(jf_hash_read8(p + 16) ^ s[2], jf_hash_read8(p + 24) ^ see1);
+                see2 = jf_hash_mum(jf_hash_read8(p + 32) ^ s[3], jf_hash_read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+
+        while (i > 16) {
+            seed = jf_hash_mum(jf_hash_read8(p) ^ s[1], jf_hash_read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+
+        a = jf_hash_read8(p + i - 16);
+        b = jf_hash_read8(p + i - 8);
+    }
+
+    a ^= s[1];
+    b ^= seed;
+
+    jf_hash_mul128(a, b, &a, &b);
+
+    return jf_hash_mum(a ^ s[0] ^ len, b ^ s[1]);
+}
+
+/*
+    long inputs: 64 byte stripes over 8 lanes, acc[i] += lo32(d ^ k) * hi32(d ^ k) and the neighbouring
+    lane gets d itself. lanes are scrambled every 16 stripes. the simd variants do the exact same math.
+*/
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#   define JF_HASH_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define JF_HASH_SSE2
+#endif
+
+#if defined(JF_HASH_AVX2)
+static void jf_hash_stripes(uint64_t* acc, const uint8_t* p, size_t stripes, const uint64_t* key) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i*) acc);
+    __m256i a1 = _mm256_loadu_si256((const __m256i*) (acc + 4));
+    const __m256i k0 = _mm256_loadu_si256((const __m256i*) key);
+    const __m256i k1 = _mm256_loadu_si256((const __m256i*) (key + 4));
+    const __m256i prime = _mm256_set1_epi32((int) JF_HASH_PRIME32);
+
+    for (size_t n = 0; n < stripes; ++n, p += JF_HASH_STRIPE) {
+        __m256i d0 = _mm256_loadu_si256((const __m256i*) p);
+        __m256i d1 = _mm256_loadu_si256((const __m256i*) (p + 32));
+        __m256i x0 = _mm256_xor_si256(d0, k0);
+        __m256i x1 = _mm256_xor_si256(d1, k1);
+
+        a0 = _mm256_add_epi64(a0, _mm256_mul_epu32(x0, _mm256_shuffle_epi32(x0, _MM_SHUFFLE(0, 3, 0, 1))));
+        a1 = _mm256_add_epi64(a1, _mm256_mul_epu32(x1, _mm256_shuffle_epi32(x1, _MM_SHUFFLE(0, 3, 0, 1))));
+        a0 = _mm256_add_epi64(a0, _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2)));
+        a1 = _mm256_add_epi64(a1, _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2)));
+
+        if ((n & 15) == 15) {
+            a0 = _mm256_xor_si256(_mm256_xor_si256(a0, _mm256_srli_epi64(a0, 47)), k0);
+            a1 = _mm256_xor_si256(_mm256_xor_si256(a1, _mm256_srli_epi64(a1, 47)), k1);
+            a0 = _mm256_add_epi64(_mm256_mul_epu32(a0, prime), _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a0, 32), prime), 32));
+            a1 = _mm256_add_epi64(_mm256_mul_epu32(a1, prime), _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a1, 32), prime), 32));
+        }
+    }
+
+    _mm256_storeu_si256((__m256i*) acc, a0);
+    _mm256_storeu_si256((__m256i*) (acc + 4), a1);
+}
+#elif defined(JF_HASH_SSE2)
+static void jf_hash_stripes(uint64_t* acc, const uint8_t* p, size_t stripes, const uint64_t* key) {
+    __m128i a[4], k[4];
+    const __m128i prime = _mm_set1_epi32((int) JF_HASH_PRIME32);
+
+    for (int j = 0; j < 4; ++j) {
+        a[j] = _mm_loadu_si128((const __m128i*) (acc + 2 * j));
+        k[j] = _mm_loadu_si128((const __m128i*) (key + 2 * j));
+    }
+
+    for (size_t n = 0; n < stripes; ++n, p += JF_HASH_STRIPE) {
+        for (int j = 0; j < 4; ++j) {
+            __m128i d = _mm_loadu_si128((const __m128i*) (p + 16 * j));
+            __m128i x = _mm_xor_si128(d, k[j]);
+
+            a[j] = _mm_add_epi64(a[j], _mm_mul_epu32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(0, 3, 0, 1))));
+            a[j] = _mm_add_epi64(a[j], _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2)));
+        }
+
+        if ((n & 15) == 15) {
+            for (int j = 0; j < 4; ++j) {
+                a[j] = _mm_xor_si128(_mm_xor_si128(a[j], _mm_srli_epi64(a[j], 47)), k[j]);
+                a[j] = _mm_add_epi64(_mm_mul_epu32(a[j], prime), _mm_slli_epi64(_mm_mul_epu32(_mm_srli_epi64(a[j], 32), prime), 32));
+            }
+        }
+    }
+
+    for (int j = 0; j < 4; ++j) {
+        _mm_storeu_si128((__m128i*) (acc + 2 * j), a[j]);
+    }
+}
+#else
+static void jf_hash_stripes(uint64_t* acc, const uint8_t* p, size_t stripes, const uint64_t* key) {
+    for (size_t n = 0; n < stripes; ++n, p += JF_HASH_STRIPE) {
+        for (int i = 0; i < 8; ++i) {
+            uint64_t d = jf_hash_read8(p + 8 * i);
+            uint64_t x = d ^ key[i];
+            acc[i ^ 1] += d;
+            acc[i] += (x & 0xffffffffull) * (x >> 32);
+        }
+
+        if ((n & 15) == 15) {
+            for (int i = 0; i < 8; ++i) {
+                acc[i] ^= acc[i] >> 47;
+                acc[i] ^= key[i];
+                acc[i] *= JF_HASH_PRIME32;
+            }
+        }
+    }
+}
+#endif
+
+uint64_t jf_hash_bytes(const void* data, size_t len, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*) data;
+
+    if (len < JF_HASH_STRIPE_MIN) {
+        return jf_hash_small(p, len, seed);
+    }
+
+    uint64_t key[8];
+    uint64_t acc[8] = {
+        0x00000000c2b2ae3dull, 0x9e3779b185ebca87ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull,
+        0x85ebca77c2b2ae63ull, 0x0000000085ebca77ull, 0x27d4eb2f165667c5ull, 0x000000009e3779b1ull
+    };
+
+    for (int i = 0; i < 8; ++i) {
+        key[i] = jf_hash_secret[i & 3] ^ (seed + (uint64_t) i * 0x9e3779b185ebca87ull);
+    }
+
+    size_t stripes = len / JF_HASH_STRIPE;
+    jf_hash_stripes(acc, p, stripes, key);
+
+    uint64_t h = (uint64_t) len * 0x9e3779b185ebca87ull;
+    for (int i = 0; i < 8; i += 2) {
+        h += jf_hash_mum(acc[i] ^ key[i], acc[i + 1] ^ key[i + 1]);
+    }
+
+    size_t done = stripes * JF_HASH_STRIPE;
+    return jf_hash_small(p + done, len - done, h);
+}
+
+uint64_t jf_hash_combine(uint64_t a, uint64_t b) {
+    return jf_hash_mum(a ^ jf_hash_secret[0], b ^ jf_hash_secret[1]);
+}
 
 /*
     STRINGS
 */
 
-jf_Error jf_string_alloc(jf_String* str, const char* data, size_t len) {
-    str->str = (char*) jf_alloc(len + 1);
+// hash is jf_hash_bytes of data, passed in when it is already known
+static jf_Error jf_string_set(jf_String* str, const char* data, size_t len, uint64_t hash, jf_Bool copy) {
+    if (len > JF_STRING_MAX_LEN) { return JF_NO_MEM; }
+
+    str->hash = hash;
+    str->len = (uint32_t) len;
+    str->allocated = JF_FALSE;
+    str->id = 0;
+
+    if (len < JF_STRING_SMALL) {
+        if (len) { memcpy(str->small, data, len); }
+        str->small[len] = 0;
+        return JF_SUCCESS;
+    }
+
+    if (!copy) {
+        str->heap = (char*) data;
+        return JF_SUCCESS;
+    }
+
+    str->heap = (char*) jf_alloc(len + 1);
+    if (!str->heap) {
+        str->len = 0;
+        str->small[0] = 0;
+        return JF_NO_MEM;
+    }
+
+    memcpy(str->heap, data, len);
+    str->heap[len] = 0;
     str->allocated = JF_TRUE;
-    
-    if (!str->str) { return JF_NO_MEM; }
-    memcpy(str->str, data, len);
-    str->str[len] = 0;
-    str->len = len;
 
     return JF_SUCCESS;
 }
 
+jf_String jf_string_view(const char* data, size_t len) {
+    jf_String str;
+    jf_string_set(&str, data, len, jf_hash_bytes(data, len), JF_FALSE);
+    return str;
+}
+
+jf_Error jf_string_alloc(jf_String* str, const char* data, size_t len) {
+    return jf_string_set(str, data, len, jf_hash_bytes(data, len), JF_TRUE);
+}
+
 jf_Error jf_string_free(jf_String* str) {
-    if (!str->allocated) { return JF_SUCCESS; }
+    if (str->allocated) { jf_free(str->heap); }
 
-    jf_free(str->str);
     str->len = 0;
+    str->small[0] = 0;
+    str->allocated = JF_FALSE;
+    str->id = 0;
     return JF_SUCCESS;
 }
 
-jf_Bool jf_string_compare(jf_String* str_a, jf_String* str_b) {
-    if (!str_a || !str_a->str || !str_b || !str_b->str) {
-        return JF_FALSE;
-    }
+jf_Bool jf_string_compare(const jf_String* str_a, const jf_String* str_b) {
+    if (!str_a || !str_b)                    { return JF_FALSE; }
+    if (str_a->id && str_a->id == str_b->id) { return JF_TRUE;  } // the same interned string
+    if (str_a->len != str_b->len)            { return JF_FALSE; }
+    if (!str_a->len)                         { return JF_TRUE;  } // zeroed strings carry no hash
+    if (str_a->hash != str_b->hash)          { return JF_FALSE; }
 
-    str_a->len = strlen(str_a->str);
-    str_b->len = strlen(str_b->str);
+    return (jf_Bool) (memcmp(jf_string_data(str_a), jf_string_data(str_b), str_a->len) == 0);
+}
 
-    if (str_a->len != str_b->len) {
-        return JF_FALSE;
+jf_Error jf_string_copy(jf_String* str_a, jf_String* str_b) {
+    if (!str_a || !str_b) {
+        return JF_NO_REF;
     }
 
-    return (jf_Bool) (strncmp(
-        str_a->str, 
-        str_b->str, 
-        JF_MATH_MIN(str_a->len, str_b->len)
-    ) == 0);
+    jf_string_free(str_a);
+    return jf_string_set(str_a, jf_string_data(str_b), str_b->len, str_b->hash, JF_TRUE);
 }
 
-jf_Error jf_string_copy(jf_String* str_a, jf_String* str_b) {
-    if (!str_a || !str_a->str || !str_b || !str_b->str) {
-        return JF_NO_REF;
+jf_Error jf_string_from_number(jf_String* str, double num) {
+    if (!str) return JF_NO_REF;
+
+    char buffer[JF_STRING_MAX_NUMBER];
+    return jf_string_alloc(str, buffer, jf_number_format(buffer, num));
+}
+
+/*
+    NUMBER FORMATTING
+*/
+
+static const char jf_number_digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+size_t jf_number_format_u64(char* buffer, uint64_t value) {
+    char digits[20];
+    char* p = digits + sizeof(digits);
+
+    // two digits per division, most numbers in a document are small
+    while (value >= 100) {
+        size_t pair = (size_t) (value % 100) * 2;
+        value /= 100;
+        p -= 2;
+        memcpy(p, jf_number_digit_pairs + pair, 2);
     }
 
-    if (str_a->len < str_b->len) {
-        str_a->str = (char*) realloc(str_a->str, str_b->len + 1);
+    if (value >= 10) {
+        p -= 2;
+        memcpy(p, jf_number_digit_pairs + value * 2, 2);
+    } else {
+        *--p = (char) ('0' + value);
     }
 
-    memcpy(str_a->str, str_b->str, str_b->len);
-    str_a->len = str_b->len;
+    size_t len = (size_t) (digits + sizeof(digits) - p);
+    memcpy(buffer, p, len);
 
-    return JF_SUCCESS;
+    return len;
 }
 
-jf_Error jf_string_from_number(jf_String* str, double num) {
-    if (!str) return JF_NO_REF;
-
-    char buffer[JF_STRING_MAX_NUMBER] = { 0 };
+size_t jf_number_format(char* buffer, jf_Number num) {
+    // integers up to 2^53 are exact, their digits already are the shortest form. -0 keeps its sign below
+    if (num > -JF_NUMBER_MAX_EXACT && num < JF_NUMBER_MAX_EXACT && num == (jf_Number) (int64_t) num && !(num == 0 && std::signbit(num))) {
+        int64_t value = (int64_t) num;
+        if (value >= 0) { return jf_number_format_u64(buffer, (uint64_t) value); }
 
-    // Use "%.17g" to ensure round-trippable representation
-    int len = snprintf(buffer, sizeof(buffer), "%.17g", num);
-    if (len < 0 || len >= JF_STRING_MAX_NUMBER) {
-        return JF_INDEX_OUT_OF_BOUNDS;
+        buffer[0] = '-';
+        return 1 + jf_number_format_u64(buffer + 1, (uint64_t) -value);
     }
 
-    return jf_string_alloc(str, buffer, (size_t)len);
+    // ryu in libstdc++, libc++ and msvc alike, the shortest digits that parse back to num
+    std::to_chars_result res = std::to_chars(buffer, buffer + JF_STRING_MAX_NUMBER, num);
+    if (res.ec != std::errc()) { return 0; }
+
+    return (size_t) (res.ptr - buffer);
+}
+
+uint64_t jf_string_hash(const jf_String* str) {
+    if (!str || !str->len) { return jf_hash_bytes(NULL, 0); }
+    return str->hash;
 }
 
 /*
@@ -87,7 +383,7 @@ jf_Error jf_string_from_number(jf_String* str, double num) {
 jf_Error jf_key_value_alloc(jf_KeyValue* kv, jf_String key) {
     if (!kv) return JF_NO_REF;
 
-    jf_Error err = jf_string_alloc(&kv->key, key.str, key.len);
+    jf_Error err = jf_string_set(&kv->key, jf_string_data(&key), key.len, jf_string_hash(&key), JF_TRUE);
     if (err != JF_SUCCESS) return err;
 
     kv->value = NULL;
@@ -108,33 +404,189 @@ jf_Error jf_key_value_free(jf_KeyValue* kv) {
 }
 
 /*
-    OBJECTS
+    SHAPES
 */
 
-jf_Error jf_object_alloc(jf_Object* obj, size_t count) {
-    if (!obj) { return JF_NO_REF; }
+uint64_t jf_shape_hash(const jf_String* keys, size_t count) {
+    uint64_t h = jf_hash_combine(JF_HASH_SEED, (uint64_t) count);
+    for (size_t i = 0; i < count; ++i) {
+        h = jf_hash_combine(h, jf_string_hash(&keys[i]));
+    }
+    return h;
+}
+
+jf_Error jf_shape_alloc(jf_Shape** shape, const jf_String* keys, size_t count, jf_Bool copy) {
+    if (!shape || (!keys && count)) { return JF_NO_REF; }
+    if (count >= UINT32_MAX / 2)    { return JF_NO_MEM; }
+
+    // at most half full, so probes stay short and always end on an empty slot
+    size_t slots = 0;
+    if (count >= JF_SHAPE_INDEX_MIN) {
+        slots = 1;
+        while (slots < count * 2) { slots <<= 1; }
+    }
+
+    *shape = (jf_Shape*) jf_calloc(1, sizeof(jf_Shape) + count * sizeof(jf_String) + slots * sizeof(uint32_t));
+    if (!*shape) { return JF_NO_MEM; }
 
-    obj->entries = (jf_KeyValue*) jf_calloc(sizeof(jf_KeyValue), count);
-    if (!obj->entries) { return JF_NO_MEM; }
+    jf_Shape* s = *shape;
+    s->count = 0;
+    s->refs = 1;
+    s->hash = jf_shape_hash(keys, count);
+    s->keys = (jf_String*) (s + 1);
+    s->index = slots ? (uint32_t*) (s->keys + count) : NULL;
+    s->mask = slots ? (uint32_t) (slots - 1) : 0;
 
-    obj->used = 0;
-    obj->size = count;
+    for (size_t i = 0; i < count; ++i) {
+        jf_Error err = jf_string_set(&s->keys[i], jf_string_data(&keys[i]), keys[i].len, jf_string_hash(&keys[i]), copy);
+        if (err) {
+            jf_shape_release(s);
+            *shape = NULL;
+            return err;
+        }
+
+        s->keys[i].id = keys[i].id;
+        s->count++;
+
+        if (s->index) {
+            uint32_t slot = (uint32_t) s->keys[i].hash & s->mask;
+            while (s->index[slot]) { slot = (slot + 1) & s->mask; }
+            s->index[slot] = (uint32_t) i + 1;
+        }
+    }
 
     return JF_SUCCESS;
 }
 
-jf_Error jf_object_free(jf_Object* obj) {
+jf_Error jf_shape_retain(jf_Shape* shape) {
+    if (!shape)                    { return JF_NO_REF; }
+    if (shape->refs == 0)          { return JF_SUCCESS; } // a table's
+    if (shape->refs == UINT32_MAX) { return JF_NO_MEM; }
+
+    shape->refs++;
+    return JF_SUCCESS;
+}
+
+jf_Error jf_shape_release(jf_Shape* shape) {
+    if (!shape)           { return JF_NO_REF; }
+    if (shape->refs == 0) { return JF_SUCCESS; }
+    if (--shape->refs)    { return JF_SUCCESS; }
+
+    for (uint32_t i = 0; i < shape->count; ++i) {
+        jf_string_free(&shape->keys[i]);
+    }
+
+    jf_free(shape);
+    return JF_SUCCESS;
+}
+
+uint32_t jf_shape_find(const jf_Shape* shape, const jf_String* key) {
+    if (!shape->index) {
+        for (uint32_t i = 0; i < shape->count; ++i) {
+            if (jf_string_compare(&shape->keys[i], key)) { return i; }
+        }
+        return shape->count;
+    }
+
+    // duplicate keys sit in insertion order along the probe, so the first one is found like a scan would
+    for (uint32_t slot = (uint32_t) jf_string_hash(key) & shape->mask; shape->index[slot]; slot = (slot + 1) & shape->mask) {
+        uint32_t i = shape->index[slot] - 1;
+        if (jf_string_compare(&shape->keys[i], key)) { return i; }
+    }
+
+    return shape->count;
+}
+
+jf_Bool jf_shape_equal(const jf_Shape* a, const jf_Shape* b) {
+    if (a == b)                                      { return JF_TRUE; }
+    if (a->count != b->count || a->hash != b->hash)  { return JF_FALSE; }
+
+    for (uint32_t i = 0; i < a->count; ++i) {
+        if (!jf_string_compare(&a->keys[i], &b->keys[i])) { return JF_FALSE; }
+    }
+
+    return JF_TRUE;
+}
+
+struct jf_ShapeCache {
+    std::unordered_multimap<uint64_t, jf_Shape*> shapes;
+};
+
+jf_Error jf_shape_cache_open(jf_ShapeCache** cache) {
+    if (!cache) { return JF_NO_REF; }
+
+    *cache = new (std::nothrow) jf_ShapeCache();
+    return *cache ? JF_SUCCESS : JF_NO_MEM;
+}
+
+jf_Error jf_shape_cache_close(jf_ShapeCache* cache) {
+    if (!cache) { return JF_NO_REF; }
+
+    for (auto& entry : cache->shapes) { jf_shape_release(entry.second); }
+    delete cache;
+
+    return JF_SUCCESS;
+}
+
+jf_Error jf_shape_cache_get(jf_ShapeCache* cache, jf_Shape** shape, const jf_String* keys, size_t count, jf_Bool copy) {
+    if (!cache || !shape || (!keys && count)) { return JF_NO_REF; }
+
+    uint64_t hash = jf_shape_hash(keys, count);
+    auto range = cache->shapes.equal_range(hash);
+
+    for (auto it = range.first; it != range.second; ++it) {
+        jf_Shape* s = it->second;
+        if (s->count != count) { continue; }
+
+        uint32_t i = 0;
+        while (i < count && jf_string_compare(&s->keys[i], &keys[i])) { ++i; }
+
+        if (i == count) {
+            *shape = s;
+            return JF_SUCCESS;
+        }
+    }
+
+    jf_Error err;
+    if (err = jf_shape_alloc(shape, keys, count, copy)) { return err; }
+
+    cache->shapes.emplace(hash, *shape);
+    return JF_SUCCESS;
+}
+
+/*
+    OBJECTS
+*/
+
+jf_Error jf_object_alloc(jf_Object** obj, jf_Shape* shape) {
+    if (!obj || !shape) { return JF_NO_REF; }
+
     jf_Error err;
+    if (err = jf_shape_retain(shape)) { return err; }
 
+    *obj = (jf_Object*) jf_calloc(1, sizeof(jf_Object) + shape->count * sizeof(jf_Node*));
+    if (!*obj) {
+        jf_shape_release(shape);
+        return JF_NO_MEM;
+    }
+
+    (*obj)->shape = shape;
+    (*obj)->used = 0;
+    (*obj)->size = shape->count;
+    (*obj)->values = (jf_Node**) (*obj + 1);
+
+    return JF_SUCCESS;
+}
+
+jf_Error jf_object_free(jf_Object* obj) {
     if (!obj) { return JF_NO_REF; }
 
     for (size_t i = 0; i < obj->used; ++i) {
-        jf_key_value_free(&obj->entries[i]);
+        jf_node_free(obj->values[i]);
     }
 
-    jf_free(obj->entries);
-    obj->size = 0;
-    obj->used = 0;
+    jf_shape_release(obj->shape);
+    jf_free(obj);
 
     return JF_SUCCESS;
 }
@@ -143,19 +595,21 @@ jf_Error jf_object_free(jf_Object* obj) {
     ARRAYS
 */
 
-jf_Error jf_array_alloc(jf_Array* arr, size_t size) {
-    if (!arr) return JF_NO_REF;
+jf_Error jf_array_alloc(jf_Array** arr, size_t size) {
+    if (!arr)               return JF_NO_REF;
+    if (size > UINT32_MAX)  return JF_NO_MEM;
 
-    arr->elements = (jf_Node**) jf_calloc(size, sizeof(jf_Node*));
-    if (!arr->elements) return JF_NO_MEM;
+    *arr = (jf_Array*) jf_calloc(1, sizeof(jf_Array) + size * sizeof(jf_Node*));
+    if (!*arr) return JF_NO_MEM;
 
-    arr->used = 0;
-    arr->size = size;
+    (*arr)->used = 0;
+    (*arr)->size = (uint32_t) size;
+    (*arr)->elements = (jf_Node**) (*arr + 1);
     return JF_SUCCESS;
 }
 
 jf_Error jf_array_free(jf_Array* arr) {
-    if (!arr || !arr->elements) return JF_NO_REF;
+    if (!arr) return JF_NO_REF;
 
     for (size_t i = 0; i < arr->size; ++i) {
         if (arr->elements[i]) {
@@ -163,10 +617,7 @@ jf_Error jf_array_free(jf_Array* arr) {
         }
     }
 
-    jf_free(arr->elements);
-    arr->elements = NULL;
-    arr->size = 0;
-    arr->used = 0;
+    jf_free(arr);
 
     return JF_SUCCESS;
 }
@@ -207,14 +658,23 @@ jf_Bool jf_array_compare(jf_Array* a, jf_Array* b) {
     NODES
 */
 
-jf_Error jf_node_alloc(jf_Node** node) {
+jf_Error jf_node_alloc(jf_Node** node, jf_Type type) {
     if (*node) { return JF_NO_MEM; }
-    *node = (jf_Node*) jf_alloc(sizeof(jf_Node));
+
+    size_t size = sizeof(jf_Node) + ((type == JF_STRING) ? sizeof(jf_String) : 0);
+    *node = (jf_Node*) jf_alloc(size);
     if (!(*node)) { return JF_NO_MEM; }
 
-    (*node)->type = JF_NULL;
-    (*node)->next = nullptr;
-    
+    (*node)->type = type;
+    (*node)->n_type = JF_NUMBER_DOUBLE;
+    (*node)->refs = 1;
+    (*node)->u_value = 0;
+
+    if (type == JF_STRING) {
+        (*node)->s_value = (jf_String*) (*node + 1);
+        memset((*node)->s_value, 0, sizeof(jf_String));
+    }
+
     return JF_SUCCESS;
 }
 
@@ -222,59 +682,334 @@ jf_Error jf_node_free(jf_Node* node) {
     jf_Error err = JF_SUCCESS;
     if (!node) { return JF_NO_REF; }
 
+    // still part of another version
+    if (--node->refs) { return JF_SUCCESS; }
 
     switch (node->type) {
-        case (JF_STRING) : err = jf_string_free(&node->s_value); break;
-        case (JF_OBJECT) : err = jf_object_free(&node->o_value); break;
-        case (JF_ARRAY)  : err = jf_array_free (&node->a_value); break;
+        case (JF_STRING) : err = jf_string_free(node->s_value); break;
+        case (JF_OBJECT) : if (node->o_value) { err = jf_object_free(node->o_value); } break;
+        case (JF_ARRAY)  : if (node->a_value) { err = jf_array_free (node->a_value); } break;
+        default: break;
     }
 
-    jf_Node* next = node->next;
     jf_free(node);
-    if (next) {
-        return jf_node_free(node->next);
-    }
 
+    return err;
+}
+
+jf_Error jf_node_retain(jf_Node* node) {
+    if (!node)                    { return JF_NO_REF; }
+    if (node->refs == UINT32_MAX) { return JF_NO_MEM; }
+
+    node->refs++;
     return JF_SUCCESS;
 }
 
+// a and b hold the same number of entries, duplicate keys pair with the first one like a lookup does
+static jf_Bool jf_object_compare_by_key(jf_Object* a, jf_Object* b) {
+    for (size_t i = 0; i < b->used; ++i) {
+        if (jf_shape_find(a->shape, &b->shape->keys[i]) == a->shape->count) {
+            return JF_FALSE;
+        }
+    }
+
+    for (size_t i = 0; i < a->used; ++i) {
+        uint32_t j = jf_shape_find(b->shape, &a->shape->keys[i]);
+
+        if (j >= b->used || !jf_node_compare(a->values[i], b->values[j])) {
+            return JF_FALSE;
+        }
+    }
+
+    return JF_TRUE;
+}
+
 jf_Bool jf_node_compare(jf_Node* a, jf_Node* b) {
+    // shared between versions
+    if (a == b) {
+        return JF_TRUE;
+    }
+
     if (a->type != b->type) {
         return JF_FALSE;
     }
 
     // compares objects
     if (a->type == JF_OBJECT) { // ew
-        if (a->o_value.size != b->o_value.size || a->o_value.used != b->o_value.used) {
+        if (a->o_value->size != b->o_value->size || a->o_value->used != b->o_value->used) {
             return JF_FALSE;
         }
 
-        for (int i = 0; i < a->o_value.size; ++i) {
-            jf_KeyValue* entry_a = & a->o_value.entries[i];
-            jf_KeyValue* entry_b = & b->o_value.entries[i];
-
-            if (!jf_string_compare(&entry_a->key, &entry_b->key)) {
-                return JF_FALSE;
+        // one shape compare covers every key
+        if (jf_shape_equal(a->o_value->shape, b->o_value->shape)) {
+            for (size_t i = 0; i < a->o_value->used; ++i) {
+                if (!jf_node_compare(a->o_value->values[i], b->o_value->values[i])) {
+                    return JF_FALSE;
+                }
             }
 
-            if (!jf_node_compare(entry_a->value, entry_b->value)) {
-                return JF_FALSE;
-            }
+            return JF_TRUE;
         }
+
+        // key order isn't part of an object's value, the same keys in another order still match by key
+        return jf_object_compare_by_key(a->o_value, b->o_value);
     }
 
     // compare primitives (and arrays)
     switch (a->type) {
         case JF_NULL:   return JF_TRUE;
         case JF_BOOL:   return (jf_Bool) (a->b_value == b->b_value);
-        case JF_NUMBER: return (jf_Bool) (a->n_value == b->n_value);
-        case JF_STRING: return jf_string_compare(&a->s_value, &b->s_value);
-        case JF_ARRAY:  return jf_array_compare(&a->a_value, &b->a_value);
+        case JF_NUMBER: return jf_node_number_equal(a, b);
+        case JF_STRING: return jf_string_compare(a->s_value, b->s_value);
+        case JF_ARRAY:  return jf_array_compare(a->a_value, b->a_value);
+    }
+
+    return JF_FALSE;
+}
+
+// structural hash, equal for any two nodes jf_node_compare considers equal whose objects
+// also share key order. jf_node_canonical_hash covers the rest
+uint64_t jf_node_hash(const jf_Node* node) {
+    if (!node) { return 0; }
+
+    uint64_t h = jf_hash_combine(JF_HASH_SEED, (uint64_t) node->type);
+
+    switch (node->type) {
+        case JF_NULL: return h;
+        case JF_BOOL: return jf_hash_combine(h, (uint64_t) node->b_value);
+
+        case JF_NUMBER: return jf_hash_combine(h, jf_node_number_bits(node));
+
+        case JF_STRING: return jf_hash_combine(h, jf_string_hash(node->s_value));
+
+        case JF_ARRAY: {
+            for (size_t i = 0; i < node->a_value->used; ++i) {
+                h = jf_hash_combine(h, jf_node_hash(node->a_value->elements[i]));
+            }
+            return h;
+        }
+
+        case JF_OBJECT: {
+            const jf_Object* obj = node->o_value;
+            for (size_t i = 0; i < obj->used; ++i) {
+                h = jf_hash_combine(h ^ jf_string_hash(&obj->shape->keys[i]), jf_node_hash(obj->values[i]));
+            }
+            return h;
+        }
+    }
+
+    return h;
+}
+
+uint64_t jf_node_canonical_hash(const jf_Node* node) {
+    if (!node) { return 0; }
+
+    switch (node->type) {
+        case JF_ARRAY: {
+            uint64_t h = jf_hash_combine(JF_HASH_SEED, (uint64_t) node->type);
+            for (size_t i = 0; i < node->a_value->used; ++i) {
+                h = jf_hash_combine(h, jf_node_canonical_hash(node->a_value->elements[i]));
+            }
+            return h;
+        }
+
+        // entries are mixed on their own and summed, so the order they appear in drops out
+        case JF_OBJECT: {
+            uint64_t sum = 0;
+            const jf_Object* obj = node->o_value;
+            for (size_t i = 0; i < obj->used; ++i) {
+                sum += jf_hash_combine(jf_string_hash(&obj->shape->keys[i]), jf_node_canonical_hash(obj->values[i]));
+            }
+
+            uint64_t h = jf_hash_combine(JF_HASH_SEED, (uint64_t) node->type);
+            return jf_hash_combine(h ^ (uint64_t) node->o_value->used, sum);
+        }
+
+        // numbers are already parsed into one representation
+        default: return jf_node_hash(node);
+    }
+}
+
+/*
+    SHARING
+*/
+
+static jf_Error jf_node_share_slot(jf_Node** slot, jf_Node* prev);
+
+// shares what it can of node's children, same is set if all of them ended up as prev's in prev's order
+static jf_Error jf_node_share_children(jf_Node* node, jf_Node* prev, jf_Bool* same) {
+    jf_Error err;
+    *same = JF_FALSE;
+
+    if (node->type == JF_ARRAY) {
+        jf_Array* a = node->a_value;
+        jf_Array* b = prev->a_value;
+        jf_Bool all = (jf_Bool) (a->size == b->size && a->used == b->used);
+
+        for (size_t i = 0; i < JF_MATH_MIN(a->used, b->used); ++i) {
+            if (err = jf_node_share_slot(&a->elements[i], b->elements[i])) { return err; }
+            all = (jf_Bool) (all && a->elements[i] == b->elements[i]);
+        }
+
+        *same = all;
+        return JF_SUCCESS;
+    }
+
+    if (node->type == JF_OBJECT) {
+        jf_Object* a = node->o_value;
+        jf_Object* b = prev->o_value;
+
+        // the same shape lines the values up, otherwise every key is looked up in prev's shape
+        jf_Bool positional = (jf_Bool) (a->used == b->used && jf_shape_equal(a->shape, b->shape));
+        jf_Bool all = positional;
+
+        // equal keys from another parse, the object keeps prev's copy even if its values changed
+        if (positional && a->shape != b->shape && jf_shape_retain(b->shape) == JF_SUCCESS) {
+            jf_shape_release(a->shape);
+            a->shape = b->shape;
+        }
+
+        for (size_t i = 0; i < a->used; ++i) {
+            uint32_t j = positional ? (uint32_t) i : jf_shape_find(b->shape, &a->shape->keys[i]);
+
+            if (j >= b->used) {
+                all = JF_FALSE;
+                continue;
+            }
+
+            if (err = jf_node_share_slot(&a->values[i], b->values[j])) { return err; }
+            all = (jf_Bool) (all && a->values[i] == b->values[j]);
+        }
+
+        *same = all;
+        return JF_SUCCESS;
+    }
+
+    return JF_SUCCESS;
+}
+
+// children first, so a container only has to check its children's pointers to know it is unchanged
+static jf_Error jf_node_share_slot(jf_Node** slot, jf_Node* prev) {
+    jf_Error err;
+    jf_Node* node = *slot;
+
+    if (node == prev || node->type != prev->type) { return JF_SUCCESS; }
+
+    jf_Bool same;
+    if (node->type == JF_OBJECT || node->type == JF_ARRAY) {
+        if (err = jf_node_share_children(node, prev, &same)) { return err; }
+    } else {
+        same = jf_node_compare(node, prev);
+    }
+
+    // a full count just means this copy isn't shared
+    if (!same || jf_node_retain(prev) != JF_SUCCESS) { return JF_SUCCESS; }
+
+    *slot = prev;
+    return jf_node_free(node);
+}
+
+jf_Error jf_node_share(jf_Node* node, jf_Node* prev) {
+    if (!node || !prev) { return JF_NO_REF; }
+    if (node == prev || node->type != prev->type) { return JF_SUCCESS; }
+    if (node->type != JF_OBJECT && node->type != JF_ARRAY) { return JF_SUCCESS; }
+
+    jf_Bool same;
+    return jf_node_share_children(node, prev, &same);
+}
+
+/*
+    NUMBERS
+*/
+
+#define JF_NUMBER_INT64_END  9223372036854775808.0  // 2^63, first double past INT64_MAX
+#define JF_NUMBER_UINT64_END 18446744073709551616.0 // 2^64
+
+// d is an integer and exactly i
+JF_INLINE jf_Bool jf_number_double_is_int(jf_Number d, int64_t i) {
+    return (jf_Bool) (d >= -JF_NUMBER_INT64_END && d < JF_NUMBER_INT64_END && (int64_t) d == i && (jf_Number) (int64_t) d == d);
+}
+
+JF_INLINE jf_Bool jf_number_double_is_uint(jf_Number d, uint64_t u) {
+    return (jf_Bool) (d >= 0 && d < JF_NUMBER_UINT64_END && (uint64_t) d == u && (jf_Number) (uint64_t) d == d);
+}
+
+jf_Number jf_node_number(const jf_Node* node) {
+    switch (node->n_type) {
+        case JF_NUMBER_INT:  return (jf_Number) node->i_value;
+        case JF_NUMBER_UINT: return (jf_Number) node->u_value;
+        default:             return node->n_value;
+    }
+}
+
+jf_Bool jf_node_number_equal(const jf_Node* a, const jf_Node* b) {
+    // the common case, no floating point involved
+    if (a->n_type == b->n_type) {
+        switch (a->n_type) {
+            case JF_NUMBER_INT:  return (jf_Bool) (a->i_value == b->i_value);
+            case JF_NUMBER_UINT: return (jf_Bool) (a->u_value == b->u_value);
+            default:             return (jf_Bool) (a->n_value == b->n_value);
+        }
+    }
+
+    if (a->n_type == JF_NUMBER_DOUBLE) { const jf_Node* t = a; a = b; b = t; }
+
+    // a is an integer from here on
+    switch (b->n_type) {
+        case JF_NUMBER_DOUBLE: {
+            return (a->n_type == JF_NUMBER_INT)
+                ? jf_number_double_is_int(b->n_value, a->i_value)
+                : jf_number_double_is_uint(b->n_value, a->u_value);
+        }
+
+        case JF_NUMBER_INT:  return (jf_Bool) (b->i_value >= 0 && (uint64_t) b->i_value == a->u_value);
+        case JF_NUMBER_UINT: return (jf_Bool) (a->i_value >= 0 && (uint64_t) a->i_value == b->u_value);
     }
 
     return JF_FALSE;
 }
 
+uint64_t jf_node_number_bits(const jf_Node* node) {
+    jf_Number d;
+
+    switch (node->n_type) {
+        case JF_NUMBER_INT: {
+            d = (jf_Number) node->i_value;
+            if (!jf_number_double_is_int(d, node->i_value)) { return jf_hash_combine(JF_NUMBER_INT, (uint64_t) node->i_value); }
+        } break;
+
+        case JF_NUMBER_UINT: {
+            d = (jf_Number) node->u_value;
+            if (!jf_number_double_is_uint(d, node->u_value)) { return jf_hash_combine(JF_NUMBER_UINT, node->u_value); }
+        } break;
+
+        default: d = node->n_value; break;
+    }
+
+    if (d == 0) { d = 0; } // -0 == 0
+
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+
+    return bits;
+}
+
+size_t jf_node_number_format(char* buffer, const jf_Node* node) {
+    switch (node->n_type) {
+        case JF_NUMBER_UINT: return jf_number_format_u64(buffer, node->u_value);
+
+        case JF_NUMBER_INT: {
+            if (node->i_value >= 0) { return jf_number_format_u64(buffer, (uint64_t) node->i_value); }
+
+            // 0 - u instead of -i, INT64_MIN has no positive int64
+            buffer[0] = '-';
+            return 1 + jf_number_format_u64(buffer + 1, 0 - (uint64_t) node->i_value);
+        }
+
+        default: return jf_number_format(buffer, node->n_value);
+    }
+}
+
 /*
     diffing (timeline comparisions)
 */
@@ -301,9 +1036,10 @@ jf_Error jf_diff_alloc_key(jf_DiffNode* node) {
         return JF_NO_MEM;
     }
 
-    node->key = (jf_String*) jf_alloc(sizeof(jf_String));
-    node->key->allocated = JF_FALSE;
-    node->key_allocated  = JF_TRUE;
+    node->key = (jf_String*) jf_calloc(1, sizeof(jf_String)); // empty until it is set
+    if (!node->key) { return JF_NO_MEM; }
+
+    node->key_allocated = JF_TRUE;
     return JF_SUCCESS;
 }
 
@@ -470,30 +1206,28 @@ jf_Error jf_compare_object_diff(jf_DiffNode* tail, jf_Object* a, jf_Object* b) {
 
     jf_Error err;
     jf_DiffNode* head = tail;
-    jf_KeyValue* entries_a = a->entries;
-    size_t entries_a_size = a->used;
-    jf_KeyValue* entries_b = b->entries;
-    size_t entries_b_size = b->used;
 
-    // parse entries a, checks for new
-    for (size_t i = 0; i < entries_a_size; ++i) {
-        jf_Bool match = JF_FALSE;
+    // the same keys in the same order, values pair up by position with no key matching
+    if (a->used == b->used && jf_shape_equal(a->shape, b->shape)) {
+        for (size_t i = 0; i < a->used; ++i) {
+            jf_DiffNode* diff;
+            if (err = jf_diff_alloc(&diff, a->values[i], b->values[i])) { return err; };
+            if (err = jf_diff_attach_next(&tail, diff))                 { return err; };
 
-        jf_Node* a_node = entries_a[i].value;
-        jf_String* a_key = &entries_a[i].key;
+            diff->key = &b->shape->keys[i];
+        }
 
-        jf_Node* b_node = NULL;
-        jf_String* b_key = NULL;
+        return jf_parse_node_layer_diff(head);
+    }
 
-        // compare keys from A to B
-        for (size_t j = 0; j < entries_b_size; ++j) {
-            b_key = &entries_b[j].key;
-            b_node = entries_b[j].value;
-            match = jf_string_compare(a_key, b_key);
-            if (match) break; 
-        }
+    // parse entries a, checks for new
+    for (size_t i = 0; i < a->used; ++i) {
+        jf_Node* a_node = a->values[i];
+        jf_String* a_key = &a->shape->keys[i];
 
-        if (!match) { b_node = NULL; }
+        // compare keys from A to B
+        uint32_t j = jf_shape_find(b->shape, a_key);
+        jf_Node* b_node = (j < b->used) ? b->values[j] : NULL;
 
         // move to next item in linked list
         jf_DiffNode* diff;
@@ -501,40 +1235,23 @@ jf_Error jf_compare_object_diff(jf_DiffNode* tail, jf_Object* a, jf_Object* b) {
         if (err = jf_diff_attach_next(&tail, diff))     { return err; };
 
         // assign key
-             if (b_node != NULL) { diff->key = b_key; }
-        else if (a_node != NULL) { diff->key = a_key; }
+        diff->key = (b_node != NULL) ? &b->shape->keys[j] : a_key;
     }
 
     // parse entries b, checks for item removal
-    for (size_t i = 0; i < entries_b_size; ++i) {
-        jf_Bool match = JF_FALSE;
-
-        jf_Node* a_node = NULL;
-        jf_String* a_key = NULL;
+    for (size_t i = 0; i < b->used; ++i) {
+        jf_Node* b_node = b->values[i];
+        jf_String* b_key = &b->shape->keys[i];
 
-        jf_Node* b_node = entries_b[i].value;
-        jf_String* b_key = &entries_b[i].key;
-
-        // compare keys from B to A
-        for (size_t j = 0; j < entries_a_size; ++j) {
-            a_key = &entries_a[j].key;
-            a_node = entries_a[j].value;
-            match = jf_string_compare(a_key, b_key);
-            if (match) break; 
-        }
-
-        // verify keys and match (cannot have dupes)
-        if (!match) { a_node = NULL; }
-        else if (jf_diff_match_key(head, b_key)) { continue; }
+        // keys A has were all paired up above
+        if (jf_shape_find(a->shape, b_key) < a->used) { continue; }
 
         // move to next item in linked list
         jf_DiffNode* diff;
-        if (err = jf_diff_alloc(&diff, a_node, b_node)) { return err; };
-        if (err = jf_diff_attach_next(&tail, diff)) { return err; };
-    
-        // assign key
-             if (a_node != NULL) { diff->key = a_key; }
-        else if (b_node != NULL) { diff->key = b_key; }
+        if (err = jf_diff_alloc(&diff, NULL, b_node)) { return err; };
+        if (err = jf_diff_attach_next(&tail, diff))   { return err; };
+
+        diff->key = b_key;
     }
 
     return jf_parse_node_layer_diff(head);
@@ -569,7 +1286,7 @@ jf_Error jf_compare_array_diff(jf_DiffNode* tail, jf_Array* a, jf_Array* b) {
             // Recurse into object
             jf_DiffNode* child = NULL;
             if (err = jf_diff_alloc(&child, NULL, NULL))                                 { return err; };
-            if (err = jf_compare_object_diff(child, &node_a->o_value, &node_b->o_value)) { return err; };
+            if (err = jf_compare_object_diff(child, node_a->o_value, node_b->o_value)) { return err; };
             diff->child = child;
             // jf_diff_attach_child(diff, child);
 
@@ -582,7 +1299,7 @@ jf_Error jf_compare_array_diff(jf_DiffNode* tail, jf_Array* a, jf_Array* b) {
             // Recurse into array
             jf_DiffNode* child = NULL;
             if (err = jf_diff_alloc(&child, NULL, NULL))                                { return err; };
-            if (err = jf_compare_array_diff(child, &node_a->a_value, &node_b->a_value)) { return err; };
+            if (err = jf_compare_array_diff(child, node_a->a_value, node_b->a_value)) { return err; };
             if (err = jf_parse_node_layer_diff(child))                                  { return err; };
             // jf_diff_attach_child(diff, child);
             
@@ -622,16 +1339,14 @@ jf_Error jf_one_sided_object_diff(jf_DiffNode* tail, jf_Object* node, jf_TreeDif
 
     jf_Error err;
     jf_DiffNode* head = tail;
-    jf_KeyValue* entries = node->entries;
     size_t count = node->used;
 
     for (size_t i = 0; i < count; ++i) {
-        jf_String* entry_key  = &entries[i].key;
-        jf_Node* entry_node  = entries[i].value;
+        jf_Node* entry_node = node->values[i];
 
         jf_DiffNode* child;
         if (err = jf_diff_alloc(&child, entry_node, NULL)) { return err; } ;
-        child->key = &entries[i].key;
+        child->key = &node->shape->keys[i];
         child->type = type;
 
         if (err = jf_parse_node_layer_diff(child)) { return err; }
@@ -679,13 +1394,13 @@ jf_Error jf_recurse_one_sided_nodes(jf_DiffNode* head, jf_Node* reference_node)
 
     // recurse one sided objects
     if (reference_node->type == JF_OBJECT) {
-        if (err = jf_one_sided_object_diff(child, &reference_node->o_value, head->type))
+        if (err = jf_one_sided_object_diff(child, reference_node->o_value, head->type))
         { return err; }
     }
 
     // recurse one sided arrays
     if (reference_node->type == JF_ARRAY) {
-        if (err = jf_one_sided_array_diff(child, &reference_node->a_value, head->type))
+        if (err = jf_one_sided_array_diff(child, reference_node->a_value, head->type))
         { return err; }
     }
 
@@ -712,8 +1427,8 @@ jf_Error jf_parse_node_layer_diff(jf_DiffNode* head) {
 
                 // recurse diff
                 jf_DiffNode* child;
-                jf_Array* array_a = &head->node_a->a_value;
-                jf_Array* array_b = &head->node_b->a_value;
+                jf_Array* array_a = head->node_a->a_value;
+                jf_Array* array_b = head->node_b->a_value;
 
                 if (err = jf_diff_alloc(&child, NULL, NULL))              { return err; };
                 if (err = jf_compare_array_diff(child, array_a, array_b)) { return err; };
@@ -727,8 +1442,8 @@ jf_Error jf_parse_node_layer_diff(jf_DiffNode* head) {
 
                 // recurse diff
                 jf_DiffNode* child;
-                jf_Object* object_a = &head->node_a->o_value;
-                jf_Object* object_b = &head->node_b->o_value;
+                jf_Object* object_a = head->node_a->o_value;
+                jf_Object* object_b = head->node_b->o_value;
 
                 if (err = jf_diff_alloc(&child, NULL, NULL))                 { return err; };
                 if (err = jf_compare_object_diff(child, object_a, object_b)) { return err; }
@@ -771,6 +1486,11 @@ jf_Error jf_timeline_context_alloc(jf_TimelineContext** context, size_t num_entr
     (*context)->nodes = (jf_Node**)     jf_calloc(sizeof(jf_Node*),     num_entries);
     (*context)->diffs = (jf_DiffNode**) jf_calloc(sizeof(jf_DiffNode*), num_entries);
     (*context)->size = num_entries;
+    (*context)->capacity = num_entries;
+    (*context)->first = 0;
+    (*context)->base = NULL;
+    (*context)->backing = NULL;
+    (*context)->backing_free = NULL;
 
     return JF_SUCCESS;
 }
@@ -794,6 +1514,14 @@ jf_Error jf_timeline_context_free(jf_TimelineContext* context) {
         }
     }
     
+    if (context->base) {
+        if (error = jf_node_free(context->base)) { return error; }
+    }
+
+    if (context->backing && context->backing_free) {
+        if (error = context->backing_free(context->backing)) { return error; }
+    }
+
     jf_free(context->files);
     jf_free(context->nodes);
     jf_free(context->diffs);
@@ -807,7 +1535,7 @@ jf_Error jf_timeline_context_add_files(jf_TimelineContext* context, const jf_Str
     jf_Error error;
 
     for (size_t i = 0; i < context->size; ++i) {
-        if (error = jf_string_alloc(&context->files[i], files[i].str, files[i].len)) { return error; };
+        if (error = jf_string_set(&context->files[i], jf_string_data(&files[i]), files[i].len, jf_string_hash(&files[i]), JF_TRUE)) { return error; };
     }
 
     return JF_SUCCESS;
@@ -869,41 +1597,160 @@ jf_Error jf_timeline_build_from_file_names(jf_Timeline** timeline, jf_TimelineCo
 
     if (!timeline || !context) { return JF_NO_REF; }
 
-    if (err = jf_timeline_alloc(timeline)) { return err; };
-    jf_Timeline* current_timeline = *timeline;
-    
-    for (int i = 0; i < context->size; ++i) {
-        jf_Node* node = NULL;
+    for (size_t i = 0; i < context->size; ++i) {
+        if (err = jf_parse_from_json_file(&context->nodes[i], context->files[i])) { return err; }
+
+        jf_Node* prev = i > 0 ? context->nodes[i - 1] : context->base;
+        if (prev && (err = jf_node_share(context->nodes[i], prev))) { return err; }
+    }
+
+    return jf_timeline_build_from_nodes(timeline, context);
+}
+
+// expects every entry of context->nodes to be parsed already, diffs already in context->diffs are kept
+jf_Error jf_timeline_build_from_nodes(jf_Timeline** timeline, jf_TimelineContext* context) {
+    jf_Error err;
+
+    if (!timeline || !context) { return JF_NO_REF; }
+
+    for (size_t i = 0; i < context->size; ++i) {
+        if (!context->nodes[i]) { return JF_NO_REF; }
+    }
+
+    // each diff only reads its two neighbouring versions, so they can all run at once
+    std::atomic<int> diff_err(JF_SUCCESS);
+    jf_parallel_for(context->size, [&](size_t i) {
+        jf_Error e;
         jf_DiffNode* diff = NULL;
-        jf_Timeline* new_timeline = NULL;
-        
-        if (err = jf_parse_from_json_file(&node, context->files[i])) { return err; }
-        if (err = jf_diff_alloc(&diff, NULL, NULL)) { return err; }
-        
-        // first node
-        if (i == 0) {
-            if (err = jf_compare_object_diff(diff, &node->o_value, NULL)) { return err; };
-            
-        // every node after
+
+        if (context->diffs[i]) { return; }
+        if (e = jf_diff_alloc(&diff, NULL, NULL)) { diff_err = e; return; }
+
+        if (i == 0 && context->base) {
+            e = jf_compare_object_diff(diff, context->base->o_value, context->nodes[i]->o_value);
+        } else if (i == 0) {
+            e = jf_compare_object_diff(diff, context->nodes[i]->o_value, NULL);
         } else {
-            if (err = jf_compare_object_diff(diff, &context->nodes[i - 1]->o_value, &node->o_value)) { return err; };
-            if (err = jf_timeline_alloc(&new_timeline));
+            e = jf_compare_object_diff(diff, context->nodes[i - 1]->o_value, context->nodes[i]->o_value);
         }
 
-        if (new_timeline != NULL) {
+        context->diffs[i] = diff;
+        if (e) { diff_err = e; }
+    });
+
+    if (diff_err != JF_SUCCESS) { return (jf_Error) diff_err.load(); }
+
+    if (err = jf_timeline_alloc(timeline)) { return err; };
+    jf_Timeline* current_timeline = *timeline;
+    
+    for (size_t i = 0; i < context->size; ++i) {
+        if (i > 0) {
+            jf_Timeline* new_timeline = NULL;
+            if (err = jf_timeline_alloc(&new_timeline))                   { return err; }
             if (err = jf_timeline_attach(current_timeline, new_timeline)) { return err; }
-            while (current_timeline->next) {
-                current_timeline = current_timeline->next;
-            }
+            current_timeline = new_timeline;
         }
         
-        current_timeline->version = i;
-        current_timeline->entry = diff;
+        current_timeline->version = context->first + i;
+        current_timeline->entry = context->diffs[i];
+    }
 
-        context->nodes[i] = node;
-        context->diffs[i] = diff;
+    return JF_SUCCESS;
+}
+
+static jf_Error jf_timeline_context_grow(jf_TimelineContext* context) {
+    size_t capacity = JF_MATH_MAX(context->capacity * 2, (size_t) 8);
+
+    jf_String*    files = (jf_String*)    jf_calloc(sizeof(jf_String),    capacity);
+    jf_Node**     nodes = (jf_Node**)     jf_calloc(sizeof(jf_Node*),     capacity);
+    jf_DiffNode** diffs = (jf_DiffNode**) jf_calloc(sizeof(jf_DiffNode*), capacity);
+
+    if (!files || !nodes || !diffs) {
+        jf_free(files);
+        jf_free(nodes);
+        jf_free(diffs);
+        return JF_NO_MEM;
     }
 
+    if (context->size) {
+        memcpy(files, context->files, context->size * sizeof(jf_String));
+        memcpy(nodes, context->nodes, context->size * sizeof(jf_Node*));
+        memcpy(diffs, context->diffs, context->size * sizeof(jf_DiffNode*));
+    }
+
+    jf_free(context->files);
+    jf_free(context->nodes);
+    jf_free(context->diffs);
+
+    context->files = files;
+    context->nodes = nodes;
+    context->diffs = diffs;
+    context->capacity = capacity;
+
+    return JF_SUCCESS;
+}
+
+jf_Error jf_timeline_push_node(jf_Timeline** timeline, jf_TimelineContext** context, jf_Node* node, jf_String id) {
+    if (!timeline || !context || !node) { return JF_NO_REF; }
+
+    jf_Error err;
+
+    if (*context == NULL) {
+        if (err = jf_timeline_context_alloc(context, 0)) { return err; }
+        (*context)->size = 0;
+    }
+
+    jf_TimelineContext* ctx = *context;
+    if (ctx->size == ctx->capacity) {
+        if (err = jf_timeline_context_grow(ctx)) { return err; }
+    }
+
+    size_t i = ctx->size;
+    jf_DiffNode* diff = NULL;
+
+    jf_Node* prev = i > 0 ? ctx->nodes[i - 1] : ctx->base;
+    if (prev && (err = jf_node_share(node, prev))) { return err; }
+
+    if (err = jf_diff_alloc(&diff, NULL, NULL)) { return err; }
+
+    if (i == 0 && ctx->base) {
+        err = jf_compare_object_diff(diff, ctx->base->o_value, node->o_value);
+    } else if (i == 0) {
+        err = jf_compare_object_diff(diff, node->o_value, NULL);
+    } else {
+        err = jf_compare_object_diff(diff, ctx->nodes[i - 1]->o_value, node->o_value);
+    }
+
+    if (err) {
+        jf_diff_free(diff);
+        return err;
+    }
+
+    jf_Timeline* entry = NULL;
+    if (err = jf_timeline_alloc(&entry)) {
+        jf_diff_free(diff);
+        return err;
+    }
+
+    if (err = jf_string_set(&ctx->files[i], jf_string_data(&id), id.len, jf_string_hash(&id), JF_TRUE)) {
+        jf_timeline_free(entry);
+        jf_diff_free(diff);
+        return err;
+    }
+
+    entry->version = ctx->first + i;
+    entry->entry = diff;
+
+    if (*timeline == NULL) {
+        *timeline = entry;
+    } else {
+        jf_timeline_attach(*timeline, entry);
+    }
+
+    ctx->nodes[i] = node;
+    ctx->diffs[i] = diff;
+    ctx->size++;
+
     return JF_SUCCESS;
 }
 
@@ -981,6 +1828,7 @@ void jf_print_error(jf_Error err) {
         case (JF_UNEXPECTED_EOF): printf("JF-RET: JF_UNEXPECTED_EOF\n"); return;
         case (JF_INVALID_TYPE): printf("JF-RET: JF_INVALID_TYPE\n"); return;
         case (JF_INVALID_FILE_PATH): printf("JF-RET: JF_INVALID_FILE_PATH\n"); return;
+        case (JF_IO_ERROR): printf("JF-RET: JF_IO_ERROR\n"); return;
         default: printf("JF-RET: UNKNOWN\n"); return;
     }
 }
@@ -1025,7 +1873,7 @@ void jf_print_diff_pair(const jf_DiffNode* node, int indent, int count) {
         jf_print_diff_action(node->type);
         // jf_print_diff_action(action);
 
-        print_key((node->key) ? node->key->str : "unknown", JF_MAX_NAME_LEN);
+        print_key((node->key) ? jf_string_data(node->key) : "unknown", JF_MAX_NAME_LEN);
         jf_print_indent(indent * count);
 
         // a val
@@ -1046,7 +1894,7 @@ void jf_print_diff_pair(const jf_DiffNode* node, int indent, int count) {
     else if (a) {
         jf_print_diff_action(node->type);
         // jf_print_diff_action(jf_match_diff_action(node->node_a, node->node_b));
-        print_key((node->key) ? node->key->str : "unknown", JF_MAX_NAME_LEN);
+        print_key((node->key) ? jf_string_data(node->key) : "unknown", JF_MAX_NAME_LEN);
         jf_print_indent(indent * count);
 
         // a val
@@ -1060,7 +1908,7 @@ void jf_print_diff_pair(const jf_DiffNode* node, int indent, int count) {
     else if (b) {
         jf_print_diff_action(node->type);
         // jf_print_diff_action(jf_match_diff_action(node->node_a, node->node_b));
-        print_key((node->key) ? node->key->str : "unknown", JF_MAX_NAME_LEN);
+        print_key((node->key) ? jf_string_data(node->key) : "unknown", JF_MAX_NAME_LEN);
         jf_print_indent(indent);
 
         // a val
@@ -1148,8 +1996,11 @@ void jf_print_value_str(jf_Node* node) {
 
     switch( node->type ) {
         case JF_NULL:   printf("NULL"); return;
-        case JF_STRING: printf("%s", node->s_value.str); return;
-        case JF_NUMBER: printf("%f", node->n_value); return;
+        case JF_STRING: printf("%.*s", (int) node->s_value->len, jf_string_data(node->s_value)); return;
+        case JF_NUMBER: {
+            char buffer[JF_STRING_MAX_NUMBER];
+            printf("%.*s", (int) jf_node_number_format(buffer, node), buffer);
+        } return;
         case JF_OBJECT: printf("<OBJECT>"); return;
         case JF_ARRAY:  printf("<ARRAY>"); return;
         case JF_BOOL:   printf("%s", (node->b_value) ? "TRUE" : "FALSE"); return;
@@ -10,6 +10,7 @@
 
 #include "stdio.h"
 #include <cstdlib>
+#include <stdint.h>
 
 
 /*
@@ -38,9 +39,10 @@
 */
 
 #ifdef JF_DEBUG_HEAP
-    extern int __jf_heap_count_alloc__;
-    extern int __jf_heap_count_free__;
-#   define JF_HEAP_TRACK() printf("\nALLOC_CALLS=%i :: FREE_CALLS=%i :: UNFREED=%i\n\n", __jf_heap_count_alloc__, __jf_heap_count_free__, __jf_heap_count_alloc__ - __jf_heap_count_free__);
+#   include <atomic>
+    extern std::atomic<int> __jf_heap_count_alloc__;
+    extern std::atomic<int> __jf_heap_count_free__;
+#   define JF_HEAP_TRACK() printf("\nALLOC_CALLS=%i :: FREE_CALLS=%i :: UNFREED=%i\n\n", __jf_heap_count_alloc__.load(), __jf_heap_count_free__.load(), __jf_heap_count_alloc__.load() - __jf_heap_count_free__.load());
 
     JF_INLINE void* jf_alloc(size_t size)                 { ++__jf_heap_count_alloc__; return malloc(size);         }
     JF_INLINE void* jf_calloc(size_t size1, size_t size2) { ++__jf_heap_count_alloc__; return calloc(size1, size2); }
@@ -96,15 +98,16 @@
 #define JF_MATH_MIN(A,B) (((A)<(B))?(A):(B))
 #define JF_MATH_MAX(A,B) (((A)>(B))?(A):(B))
 
-#define JF_STRING(str, size) { (char*) str, size }
-#define JF_STRING_STATIC(str) { (char*) str, sizeof(str) }
-#define JF_STRING_CONST(str) { (char*) str, strlen(str) }
+#define JF_STRING(str, size) jf_string_view(str, size)
+#define JF_STRING_STATIC(str) jf_string_view(str, sizeof(str))
+#define JF_STRING_CONST(str) jf_string_view(str, strlen(str))
 #define JF_STRING_MAX_NUMBER 0x20
 #define JF_MAX_NAME_LEN      0x10
 
 typedef double jf_Number;
 struct jf_Node;
 struct jf_KeyValue;
+struct jf_Shape;
 struct jf_Object;
 struct jf_Array;
 struct jf_String;
@@ -113,7 +116,7 @@ struct jf_DiffNode;
 /*
     types
 */
-enum jf_Type {
+enum jf_Type : uint8_t {
     JF_NULL,
     JF_BOOL,
     JF_NUMBER,
@@ -132,6 +135,7 @@ enum jf_Error {
     JF_UNEXPECTED_EOF,
     JF_INVALID_TYPE,
     JF_INVALID_FILE_PATH,
+    JF_IO_ERROR,
 };
 
 enum jf_Bool {
@@ -147,20 +151,67 @@ enum jf_TreeDiff {
     JF_DIFF_UNKNOWN
 };
 
+/*
+    hashing - wyhash style 64 bit hash, long inputs run 8 accumulator lanes (sse2/avx2 when available)
+*/
+
+#define JF_HASH_SEED        0x2d358dccaa6c78a5ull
+#define JF_HASH_STRIPE      64
+#define JF_HASH_STRIPE_MIN  256
+
+uint64_t jf_hash_bytes(const void* data, size_t len, uint64_t seed = JF_HASH_SEED);
+uint64_t jf_hash_combine(uint64_t a, uint64_t b);
+
 /*
     wrapper because std::string ew
+
+    strings shorter than JF_STRING_SMALL are stored inline, longer ones point at their bytes.
+    the length and jf_hash_bytes of the bytes are set whenever a string is made, so compares
+    and hashing never touch the bytes unless they have to. read through jf_string_data, owned
+    and inline strings are '\0' terminated. zeroed memory is a valid empty string.
+
+    interned strings (string_intern.hpp) also carry the id of their canonical copy, strings
+    with the same nonzero id hold the same bytes.
 */
+#define JF_STRING_SMALL   16
+#define JF_STRING_MAX_LEN 0x7fffffff
+
 struct jf_String {
-    char* str;
-    size_t len;
-    jf_Bool allocated;
+    union {
+        char* heap;                   // len >= JF_STRING_SMALL
+        char  small[JF_STRING_SMALL]; // len <  JF_STRING_SMALL
+    };
+    uint64_t hash;
+    uint32_t len       : 31;
+    uint32_t allocated : 1; // heap is ours to free
+    uint32_t id;            // intern id, 0 when not interned
 };
 
+JF_INLINE const char* jf_string_data(const jf_String* str) {
+    return (str->len < JF_STRING_SMALL) ? str->small : str->heap;
+}
+
+// borrows data for as long as the string is used, short ones are copied inline
+jf_String jf_string_view(const char* data, size_t len);
+
 jf_Error jf_string_alloc(jf_String* str, const char* data, size_t len);
 jf_Error jf_string_free(jf_String* str);
-jf_Bool  jf_string_compare(jf_String* str_a, jf_String* str_b);
+jf_Bool  jf_string_compare(const jf_String* str_a, const jf_String* str_b);
 jf_Error jf_string_copy(jf_String* str_a, jf_String* str_b);
 jf_Error jf_string_from_number(jf_String* str, double num);
+uint64_t jf_string_hash(const jf_String* str);
+
+/*
+    number formatting - the shortest text that parses back to the same double, integers take a fast path
+*/
+
+#define JF_NUMBER_MAX_EXACT 9007199254740992.0 // 2^53, every integer below it is a double
+
+// writes at most JF_STRING_MAX_NUMBER bytes and no '\0', returns how many
+size_t jf_number_format(char* buffer, jf_Number num);
+
+// at most 20 bytes, no '\0'
+size_t jf_number_format_u64(char* buffer, uint64_t value);
 
 
 /*
@@ -174,52 +225,135 @@ struct jf_KeyValue {
 jf_Error jf_key_value_alloc(jf_KeyValue* kv, jf_String key);
 jf_Error jf_key_value_free(jf_KeyValue* kv);
 
+/*
+    shapes - the keys of an object in order, one shape for every object with the same keys in
+    the same order. the keys are stored once and objects that share a shape line up value for
+    value. shapes with JF_SHAPE_INDEX_MIN keys or more carry a hash index for key lookups,
+    smaller ones are scanned
+*/
+#define JF_SHAPE_INDEX_MIN 8
+
+struct jf_Shape { // fixed allocator, the keys and the index follow the header in the same block
+    uint32_t count;
+    uint32_t refs;   // objects using it. 0 for a shape a jf_InternTable owns, objects never release those
+    uint64_t hash;   // jf_shape_hash of the keys
+    jf_String* keys;
+    uint32_t* index; // mask + 1 slots holding a key's position + 1, 0 when empty. NULL below JF_SHAPE_INDEX_MIN keys
+    uint32_t mask;
+};
+
+// keys are copied, or with copy false borrowed for as long as the shape lives. the caller holds the one reference
+jf_Error jf_shape_alloc(jf_Shape** shape, const jf_String* keys, size_t count, jf_Bool copy);
+jf_Error jf_shape_retain(jf_Shape* shape);
+jf_Error jf_shape_release(jf_Shape* shape);
+
+uint64_t jf_shape_hash(const jf_String* keys, size_t count);
+
+// position of key in shape, shape->count if it has no such key
+uint32_t jf_shape_find(const jf_Shape* shape, const jf_String* key);
+
+// the same keys in the same order
+jf_Bool jf_shape_equal(const jf_Shape* a, const jf_Shape* b);
+
+// hands out one shape per key list while trees are built, the objects keep their shapes after it is closed
+struct jf_ShapeCache;
+
+jf_Error jf_shape_cache_open(jf_ShapeCache** cache);
+jf_Error jf_shape_cache_close(jf_ShapeCache* cache);
+
+// the cache's shape for keys, made by jf_shape_alloc the first time. the cache holds the reference
+jf_Error jf_shape_cache_get(jf_ShapeCache* cache, jf_Shape** shape, const jf_String* keys, size_t count, jf_Bool copy);
+
 /*
     wrapper for if_Node, contains a generic
 */
-struct jf_Object { // fixed allocator
-    size_t size;
-    size_t used;
-    jf_KeyValue* entries;
+struct jf_Object { // fixed allocator, one value per key of the shape follows the header in the same block
+    jf_Shape* shape;
+    uint32_t size;
+    uint32_t used;   // values set so far, only the first used are released
+    jf_Node** values;
 };
 
-jf_Error jf_object_alloc(jf_Object* obj, size_t count);
+// shape gains a reference
+jf_Error jf_object_alloc(jf_Object** obj, jf_Shape* shape);
 jf_Error jf_object_free(jf_Object* obj);
 
 /*
     multile generic json types
 */
-struct jf_Array { // fixed allocator
-    size_t size;
-    size_t used;
+struct jf_Array { // fixed allocator, the elements follow the header in the same block
+    uint32_t size;
+    uint32_t used;
     jf_Node** elements;
 };
 
-jf_Error jf_array_alloc(jf_Array* array, size_t size);
+jf_Error jf_array_alloc(jf_Array** array, size_t size);
 jf_Error jf_array_free(jf_Array* array);
 jf_Bool  jf_array_compare(jf_Array* a, jf_Array* b);
 jf_Bool  jf_array_contains(jf_Array* arr, jf_Node* val);
 
 /*
-    generic json type
+    numbers - integers that fit 64 bits are kept exact, everything else is a double
+*/
+enum jf_NumberType : uint8_t {
+    JF_NUMBER_DOUBLE, // n_value
+    JF_NUMBER_INT,    // i_value, any integer an int64_t holds
+    JF_NUMBER_UINT,   // u_value, only the ones above INT64_MAX
+};
+
+/*
+    generic json type - a tag and one word, 16 bytes. numbers and bools live in the word,
+    a string right behind its node in the same allocation, objects and arrays in a block
+    of their own made by jf_object_alloc / jf_array_alloc
+
+    versions of a timeline share the subtrees they have in common (jf_node_share), so a node
+    can have more than one owner. jf_node_free only releases it once the last one lets go.
+    the count isn't atomic, a tree and every tree sharing with it are freed from one thread
 */
 struct jf_Node {
     jf_Type type;
+    jf_NumberType n_type; // which member holds a JF_NUMBER
+    uint32_t refs;        // owners, 1 from jf_node_alloc
 
     union {
         jf_Number   n_value;
-        jf_Object   o_value;
-        jf_Array    a_value;
+        int64_t     i_value;
+        uint64_t    u_value;
         jf_Bool     b_value;
-        jf_String   s_value;
+        jf_String*  s_value;
+        jf_Object*  o_value; // NULL until the block is allocated
+        jf_Array*   a_value;
     };
-
-    jf_Node* next;
 };
 
-jf_Error jf_node_alloc(jf_Node** obj);
+// the type is fixed here, a JF_STRING node is allocated with room for its string (empty until set)
+jf_Error jf_node_alloc(jf_Node** obj, jf_Type type = JF_NULL);
 jf_Error jf_node_free(jf_Node* obj);
+jf_Error jf_node_retain(jf_Node* node); // one more owner, JF_NO_MEM once the count is full
 jf_Bool  jf_node_compare(jf_Node* node_a, jf_Node* node_b);
+uint64_t jf_node_hash(const jf_Node* node);
+
+// like jf_node_hash but blind to object key order, documents that only differ in
+// formatting, key order or number spelling (1.0 vs 1e0) hash the same
+uint64_t jf_node_canonical_hash(const jf_Node* node);
+
+// the value as a double, integers past 2^53 get rounded
+jf_Number jf_node_number(const jf_Node* node);
+
+// exact across types, 1 equals 1.0 but 2^53 + 1 doesn't equal 2^53
+jf_Bool jf_node_number_equal(const jf_Node* a, const jf_Node* b);
+
+// what jf_node_hash mixes in for a number, the same for any two jf_node_number_equal considers equal.
+// an integer a double holds exactly gives that double's bits, so those hash as they did before integers were kept
+uint64_t jf_node_number_bits(const jf_Node* node);
+
+// jf_number_format for doubles, straight to digits for integers
+size_t jf_node_number_format(char* buffer, const jf_Node* node);
+
+// swaps every subtree of node that holds the same value as the one at the same key / index
+// of prev for prev's, which gains an owner. node itself stays its own. called on a version
+// before it joins a timeline after prev, so unchanged parts are stored once and compare by pointer
+jf_Error jf_node_share(jf_Node* node, jf_Node* prev);
 
 /*
     diffing (timeline comparisons)
@@ -274,10 +408,19 @@ jf_Error jf_parse_node_layer_diff(jf_DiffNode* head);
 
 struct jf_TimelineContext {
     size_t size;
+    size_t capacity;
+    size_t first; // version number of nodes[0], above 0 when only a window of a longer history is loaded
 
     jf_String* files;
     jf_Node** nodes;
     jf_DiffNode** diffs;
+
+    // version first - 1, the other side of diffs[0] when the window starts past the first version
+    jf_Node* base;
+
+    // memory the nodes' strings may point into, released after the nodes are
+    void* backing;
+    jf_Error (*backing_free)(void* backing);
 };
 
 jf_Error jf_timeline_context_alloc(jf_TimelineContext** context, size_t num_entries);
@@ -308,6 +451,11 @@ jf_Error jf_timeline_attach(jf_Timeline* a, jf_Timeline* b);
 
 jf_Error jf_timeline_build_from_file_names(jf_Timeline** timeline, jf_TimelineContext* context);
 
+jf_Error jf_timeline_build_from_nodes(jf_Timeline** timeline, jf_TimelineContext* context);
+
+// appends an already parsed version, the context takes ownership of node
+jf_Error jf_timeline_push_node(jf_Timeline** timeline, jf_TimelineContext** context, jf_Node* node, jf_String id);
+
 jf_Error jf_timeline_filter_path(jf_Timeline* main_timeline, jf_Timeline** filtered, jf_String* path, size_t path_len);
 
 
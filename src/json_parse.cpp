@@ -1,66 +1,98 @@
 #include "json_parse.hpp"
+#include "string.h"
 
-jf_Error jf_from_json(const json& j, jf_Node** out) {
+#include <charconv>
+#include <cmath>
+#include <string>
+#include <vector>
+
+jf_Error jf_from_json(const json& j, jf_Node** out, jf_ShapeCache* shapes) {
     jf_Error err;
+    jf_Type type;
+
+         if (j.is_null())    { type = JF_NULL;   }
+    else if (j.is_boolean()) { type = JF_BOOL;   }
+    else if (j.is_number())  { type = JF_NUMBER; }
+    else if (j.is_string())  { type = JF_STRING; }
+    else if (j.is_object())  { type = JF_OBJECT; }
+    else if (j.is_array())   { type = JF_ARRAY;  }
+    else                     { return JF_INVALID_TYPE; }
 
-    err = jf_node_alloc(out);
+    err = jf_node_alloc(out, type);
     if (err != JF_SUCCESS) return err;
 
     jf_Node* node = *out;
 
-    if (j.is_null()) {
-        node->type = JF_NULL;
-    } 
-
-    else if (j.is_boolean()) {
-        node->type = JF_BOOL;
+    if (j.is_boolean()) {
         node->b_value = j.get<bool>() ? JF_TRUE : JF_FALSE;
     } 
 
+    else if (j.is_number_unsigned()) {
+        node->u_value = j.get<uint64_t>();
+        node->n_type = (node->u_value <= (uint64_t) INT64_MAX) ? JF_NUMBER_INT : JF_NUMBER_UINT;
+    }
+
+    else if (j.is_number_integer()) {
+        node->n_type = JF_NUMBER_INT;
+        node->i_value = j.get<int64_t>();
+    }
+
     else if (j.is_number()) {
-        node->type = JF_NUMBER;
         node->n_value = j.get<jf_Number>();
     } 
 
     else if (j.is_string()) {
-        node->type = JF_STRING;
         const std::string& s = j.get_ref<const std::string&>();
-        err = jf_string_alloc(&node->s_value, s.c_str(), s.size());
+        err = jf_string_alloc(node->s_value, s.c_str(), s.size());
         if (err != JF_SUCCESS) return err;
     }
 
     else if (j.is_object()) {
-        node->type = JF_OBJECT;
-        err = build_object(j, &node->o_value);
+        err = build_object(j, &node->o_value, shapes);
         if (err != JF_SUCCESS) return err;
     }
 
     else if (j.is_array()) {
-        node->type = JF_ARRAY;
-        err = build_array(j, &node->a_value);
+        err = build_array(j, &node->a_value, shapes);
         if (err != JF_SUCCESS) return err;
     }
 
-    else {
-        return JF_INVALID_TYPE;
-    }
-
     return JF_SUCCESS;
 }
 
-jf_Error build_object(const json& j_obj, jf_Object* out_obj) {
-    size_t count = j_obj.size();
-    jf_Error err = jf_object_alloc(out_obj, count);
-    if (err != JF_SUCCESS) return err;
+jf_Error build_object(const json& j_obj, jf_Object** out, jf_ShapeCache* shapes) {
+    jf_Error err;
+
+    // borrowed from j_obj, the shape copies them
+    std::vector<jf_String> keys;
+    keys.reserve(j_obj.size());
 
-    size_t index = 0;
     for (auto it = j_obj.begin(); it != j_obj.end(); ++it) {
-        jf_KeyValue* kv = &out_obj->entries[index++];
+        keys.push_back(JF_STRING(it.key().c_str(), it.key().size()));
+    }
 
-        err = jf_key_value_alloc(kv, JF_STRING(it.key().c_str(), it.key().size()));
+    jf_Shape* shape = NULL;
+
+    if (shapes) {
+        err = jf_shape_cache_get(shapes, &shape, keys.data(), keys.size(), JF_TRUE);
+        if (err != JF_SUCCESS) return err;
+
+        err = jf_object_alloc(out, shape);
+    } else {
+        err = jf_shape_alloc(&shape, keys.data(), keys.size(), JF_TRUE);
         if (err != JF_SUCCESS) return err;
 
-        err = jf_from_json(it.value(), &kv->value);
+        err = jf_object_alloc(out, shape);
+        jf_shape_release(shape);
+    }
+
+    if (err != JF_SUCCESS) return err;
+
+    jf_Object* out_obj = *out;
+
+    size_t index = 0;
+    for (auto it = j_obj.begin(); it != j_obj.end(); ++it) {
+        err = jf_from_json(it.value(), &out_obj->values[index++], shapes);
         if (err != JF_SUCCESS) return err;
 
         out_obj->used++;
@@ -69,14 +101,16 @@ jf_Error build_object(const json& j_obj, jf_Object* out_obj) {
     return JF_SUCCESS;
 }
 
-jf_Error build_array(const json& j_arr, jf_Array* out_arr) {
+jf_Error build_array(const json& j_arr, jf_Array** out, jf_ShapeCache* shapes) {
     size_t count = j_arr.size();
-    jf_Error err = jf_array_alloc(out_arr, count);
+    jf_Error err = jf_array_alloc(out, count);
     if (err != JF_SUCCESS) return err;
 
+    jf_Array* out_arr = *out;
+
     for (size_t i = 0; i < count; ++i) {
         jf_Node* child = nullptr;
-        err = jf_from_json(j_arr[i], &child);
+        err = jf_from_json(j_arr[i], &child, shapes);
         if (err != JF_SUCCESS) return err;
 
         out_arr->elements[i] = child;
@@ -86,8 +120,547 @@ jf_Error build_array(const json& j_arr, jf_Array* out_arr) {
     return JF_SUCCESS;
 }
 
+/*
+    direct parser - builds jf_Nodes straight from the buffer, no tokenizer or intermediate json dom.
+    children are staged on shared scratch stacks and moved into exactly sized objects / arrays
+    once their container closes, containers are tracked on an explicit stack so depth costs no
+    native stack. keys are staged as views into the buffer and only copied when a key list
+    shows up for the first time, every object with the same keys in the document shares its shape.
+
+    numbers are decoded where they stand. plain integers that fit 64 bits are accumulated digit
+    by digit and kept as integers, anything else goes through std::from_chars, an eisel-lemire
+    fast path in libstdc++ 12+ and msvc. strings without escapes are copied straight out of the
+    buffer.
+*/
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define JF_JSON_PARSE_SSE2
+#endif
+
+
+#define JF_JSON_PARSE_INT_DIGITS 20 // UINT64_MAX, anything longer can't be an integer
+
+struct jf_JsonParser {
+    struct Frame {
+        jf_Node* node;
+        size_t start; // first scratch slot owned by this container
+    };
+
+    const char* p;
+    const char* end;
+
+    jf_Node* root = NULL;
+    jf_Error err = JF_SUCCESS;
+
+    jf_ShapeCache* shapes = NULL;
+
+    jf_String key = {};  // key of the entry being parsed, a view into the buffer unless it had escapes
+    std::string scratch; // strings with escapes are unescaped here
+    std::vector<Frame> stack;
+    std::vector<jf_String> keys; // object entries, keys[i] goes with values[i]
+    std::vector<jf_Node*> values;
+    std::vector<jf_Node*> elements;
+
+    bool fail(jf_Error e) {
+        if (!err) { err = e; }
+        return false;
+    }
+
+    void skip_whitespace() {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) { ++p; }
+    }
+
+    bool attach(jf_Node* node) {
+        if (stack.empty()) {
+            root = node;
+            return true;
+        }
+
+        if (stack.back().node->type == JF_OBJECT) {
+            keys.push_back(key);
+            values.push_back(node);
+            key = {};
+        } else {
+            elements.push_back(node);
+        }
+
+        return true;
+    }
+
+    bool value(jf_Type type, jf_Node** out) {
+        jf_Node* node = NULL;
+        if (jf_node_alloc(&node, type)) { return fail(JF_NO_MEM); }
+
+        *out = node;
+        return true;
+    }
+
+    bool literal(const char* text, size_t len) {
+        if ((size_t) (end - p) < len)   { return fail(JF_UNEXPECTED_EOF); }
+        if (memcmp(p, text, len) != 0)  { return fail(JF_INVALID_SYNTAX); }
+
+        p += len;
+        return true;
+    }
+
+    /* strings */
+
+    // length of the leading run that is plain ascii with nothing to unescape
+    size_t plain_run(const char* s) {
+        const char* start = s;
+
+#if defined(JF_JSON_PARSE_SSE2)
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i slash = _mm_set1_epi8('\\');
+        const __m128i ctrl  = _mm_set1_epi8(0x1f);
+
+        while (end - s >= 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*) s);
+            __m128i hit = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)),
+                _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v)
+            );
+
+            // the high bit of v itself flags utf-8, those bytes get validated one by one
+            unsigned mask = (unsigned) (_mm_movemask_epi8(hit) | _mm_movemask_epi8(v));
+            if (mask) {
+#if defined(_MSC_VER)
+                unsigned long index;
+                _BitScanForward(&index, mask);
+                return (size_t) (s - start) + index;
+#else
+                return (size_t) (s - start) + (size_t) __builtin_ctz(mask);
+#endif
+            }
+
+            s += 16;
+        }
+#endif
+
+        while (s < end) {
+            unsigned char c = (unsigned char) *s;
+            if (c == '"' || c == '\\' || c < 0x20 || c >= 0x80) { break; }
+            ++s;
+        }
+
+        return (size_t) (s - start);
+    }
+
+    // one utf-8 sequence starting at p, the same well formedness rules as the rest of the json world
+    bool utf8() {
+        const unsigned char* s = (const unsigned char*) p;
+        size_t left = (size_t) (end - p);
+        unsigned char c = s[0];
+
+        size_t len;
+        unsigned char lo = 0x80;
+        unsigned char hi = 0xbf;
+
+        if      (c >= 0xc2 && c <= 0xdf) { len = 2; }
+        else if (c == 0xe0)              { len = 3; lo = 0xa0; }
+        else if (c >= 0xe1 && c <= 0xec) { len = 3; }
+        else if (c == 0xed)              { len = 3; hi = 0x9f; }
+        else if (c >= 0xee && c <= 0xef) { len = 3; }
+        else if (c == 0xf0)              { len = 4; lo = 0x90; }
+        else if (c >= 0xf1 && c <= 0xf3) { len = 4; }
+        else if (c == 0xf4)              { len = 4; hi = 0x8f; }
+        else                             { return fail(JF_INVALID_SYNTAX); }
+
+        if (left < len)                  { return fail(JF_UNEXPECTED_EOF); }
+        if (s[1] < lo || s[1] > hi)      { return fail(JF_INVALID_SYNTAX); }
+
+        for (size_t i = 2; i < len; ++i) {
+            if ((s[i] & 0xc0) != 0x80)   { return fail(JF_INVALID_SYNTAX); }
+        }
+
+        p += len;
+        return true;
+    }
+
+    bool hex4(uint32_t* out) {
+        if (end - p < 4) { return fail(JF_UNEXPECTED_EOF); }
+
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = p[i];
+            v <<= 4;
+
+            if      (c >= '0' && c <= '9') { v |= (uint32_t) (c - '0'); }
+            else if (c >= 'a' && c <= 'f') { v |= (uint32_t) (c - 'a' + 10); }
+            else if (c >= 'A' && c <= 'F') { v |= (uint32_t) (c - 'A' + 10); }
+            else                           { return fail(JF_INVALID_ESCAPE); }
+        }
+
+        p += 4;
+        *out = v;
+        return true;
+    }
+
+    bool escape() {
+        if (p == end) { return fail(JF_UNEXPECTED_EOF); }
+
+        switch (*p++) {
+            case '"':  scratch += '"';  return true;
+            case '\\': scratch += '\\'; return true;
+            case '/':  scratch += '/';  return true;
+            case 'b':  scratch += '\b'; return true;
+            case 'f':  scratch += '\f'; return true;
+            case 'n':  scratch += '\n'; return true;
+            case 'r':  scratch += '\r'; return true;
+            case 't':  scratch += '\t'; return true;
+            case 'u':  break;
+            default:   return fail(JF_INVALID_ESCAPE);
+        }
+
+        uint32_t cp;
+        if (!hex4(&cp)) { return false; }
+
+        // a high surrogate only counts together with the low one right after it
+        if (cp >= 0xd800 && cp <= 0xdbff) {
+            uint32_t low;
+            if (end - p < 2 || p[0] != '\\' || p[1] != 'u') { return fail(JF_INVALID_ESCAPE); }
+
+            p += 2;
+            if (!hex4(&low))                                { return false; }
+            if (low < 0xdc00 || low > 0xdfff)               { return fail(JF_INVALID_ESCAPE); }
+
+            cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+        } else if (cp >= 0xdc00 && cp <= 0xdfff) {
+            return fail(JF_INVALID_ESCAPE);
+        }
+
+        if (cp < 0x80) {
+            scratch += (char) cp;
+        } else if (cp < 0x800) {
+            scratch += (char) (0xc0 | (cp >> 6));
+            scratch += (char) (0x80 | (cp & 0x3f));
+        } else if (cp < 0x10000) {
+            scratch += (char) (0xe0 | (cp >> 12));
+            scratch += (char) (0x80 | ((cp >> 6) & 0x3f));
+            scratch += (char) (0x80 | (cp & 0x3f));
+        } else {
+            scratch += (char) (0xf0 | (cp >> 18));
+            scratch += (char) (0x80 | ((cp >> 12) & 0x3f));
+            scratch += (char) (0x80 | ((cp >> 6) & 0x3f));
+            scratch += (char) (0x80 | (cp & 0x3f));
+        }
+
+        return true;
+    }
+
+    // p is on the opening quote. str / len point into the buffer, or into scratch if anything was unescaped
+    bool string(const char** str, size_t* len) {
+        const char* start = ++p;
+        bool escaped = false;
+
+        for (;;) {
+            const char* run = p;
+            p += plain_run(p);
+            if (escaped) { scratch.append(run, (size_t) (p - run)); }
+
+            if (p == end) { return fail(JF_UNEXPECTED_EOF); }
+
+            unsigned char c = (unsigned char) *p;
+
+            if (c == '"') {
+                break;
+            } else if (c == '\\') {
+                if (!escaped) {
+                    scratch.assign(start, (size_t) (p - start));
+                    escaped = true;
+                }
+
+                ++p;
+                if (!escape()) { return false; }
+            } else if (c >= 0x80) {
+                const char* seq = p;
+                if (!utf8()) { return false; }
+                if (escaped) { scratch.append(seq, (size_t) (p - seq)); }
+            } else {
+                return fail(JF_INVALID_SYNTAX); // raw control character
+            }
+        }
+
+        *str = escaped ? scratch.data() : start;
+        *len = escaped ? scratch.size() : (size_t) (p - start);
+
+        ++p; // closing quote
+        return true;
+    }
+
+    /* numbers */
+
+    // only the number fields of out are set
+    bool number(jf_Node* out) {
+        const char* start = p;
+        bool negative = *p == '-';
+        if (negative) { ++p; }
+
+        if (p == end) { return fail(JF_UNEXPECTED_EOF); }
+
+        const char* digits = p;
+        if (*p == '0') {
+            ++p;
+        } else if (*p >= '1' && *p <= '9') {
+            while (p < end && *p >= '0' && *p <= '9') { ++p; }
+        } else {
+            return fail(JF_INVALID_SYNTAX);
+        }
+
+        size_t int_digits = (size_t) (p - digits);
+        bool integer = true;
+
+        if (p < end && *p == '.') {
+            ++p;
+            integer = false;
+
+            if (p == end || *p < '0' || *p > '9') { return fail(p == end ? JF_UNEXPECTED_EOF : JF_INVALID_SYNTAX); }
+            while (p < end && *p >= '0' && *p <= '9') { ++p; }
+        }
+
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            ++p;
+            integer = false;
+
+            if (p < end && (*p == '+' || *p == '-')) { ++p; }
+            if (p == end || *p < '0' || *p > '9') { return fail(p == end ? JF_UNEXPECTED_EOF : JF_INVALID_SYNTAX); }
+            while (p < end && *p >= '0' && *p <= '9') { ++p; }
+        }
+
+        // the common case, counters, ids, indices. an integer -0 is plain 0, same as it always parsed
+        if (integer && int_digits <= JF_JSON_PARSE_INT_DIGITS) {
+            uint64_t v = 0;
+            bool fits = true;
+
+            for (const char* d = digits; d < p; ++d) {
+                uint64_t digit = (uint64_t) (*d - '0');
+                if (v > (UINT64_MAX - digit) / 10) { fits = false; break; }
+                v = v * 10 + digit;
+            }
+
+            if (fits && negative && v <= (uint64_t) INT64_MAX + 1) {
+                out->n_type = JF_NUMBER_INT;
+                out->i_value = (int64_t) (0 - v);
+                return true;
+            }
+
+            if (fits && !negative) {
+                out->n_type = (v <= (uint64_t) INT64_MAX) ? JF_NUMBER_INT : JF_NUMBER_UINT;
+                out->u_value = v;
+                return true;
+            }
+        }
+
+        out->n_type = JF_NUMBER_DOUBLE;
+
+#if defined(__cpp_lib_to_chars)
+        std::from_chars_result res = std::from_chars(start, p, out->n_value);
+        if (res.ec == std::errc() && res.ptr == p) { return true; }
+#endif
+
+        // out of range for a double, or no from_chars for doubles on this toolchain. too small
+        // rounds to 0, too large has no double to be and is rejected
+        std::string text(start, (size_t) (p - start));
+        out->n_value = strtod(text.c_str(), NULL);
+
+        return std::isfinite(out->n_value) || fail(JF_INVALID_SYNTAX);
+    }
+
+    /* values */
+
+    // a scalar gets attached, a container is opened and left on the stack
+    bool parse_value() {
+        if (p == end) { return fail(JF_UNEXPECTED_EOF); }
+
+        jf_Node* node;
+
+        switch (*p) {
+            case '{':
+            case '[': {
+                jf_Type type = (*p == '{') ? JF_OBJECT : JF_ARRAY;
+                ++p;
+
+                // no block until the container closes, safe to free in the meantime
+                if (!value(type, &node)) { return false; }
+
+                if (!attach(node)) { return false; }
+
+                stack.push_back({ node, (type == JF_OBJECT) ? values.size() : elements.size() });
+                return true;
+            }
+
+            case '"': {
+                const char* str;
+                size_t len;
+
+                if (!string(&str, &len))      { return false; }
+                if (!value(JF_STRING, &node)) { return false; }
+
+                if (jf_string_alloc(node->s_value, str, len)) {
+                    jf_node_free(node);
+                    return fail(JF_NO_MEM);
+                }
+
+                return attach(node);
+            }
+
+            case 't': {
+                if (!literal("true", 4) || !value(JF_BOOL, &node)) { return false; }
+                node->b_value = JF_TRUE;
+                return attach(node);
+            }
+
+            case 'f': {
+                if (!literal("false", 5) || !value(JF_BOOL, &node)) { return false; }
+                node->b_value = JF_FALSE;
+                return attach(node);
+            }
+
+            case 'n': {
+                if (!literal("null", 4) || !value(JF_NULL, &node)) { return false; }
+                return attach(node);
+            }
+
+            default: {
+                jf_Node num;
+                if (!number(&num) || !value(JF_NUMBER, &node)) { return false; }
+
+                node->n_type = num.n_type;
+                node->u_value = num.u_value;
+                return attach(node);
+            }
+        }
+    }
+
+    bool close_container() {
+        Frame frame = stack.back();
+        stack.pop_back();
+
+        if (frame.node->type == JF_OBJECT) {
+            size_t count = values.size() - frame.start;
+
+            jf_Shape* shape = NULL;
+            if (jf_shape_cache_get(shapes, &shape, keys.data() + frame.start, count, JF_TRUE)) { return fail(JF_NO_MEM); }
+            if (jf_object_alloc(&frame.node->o_value, shape))                                 { return fail(JF_NO_MEM); }
+
+            jf_Object* obj = frame.node->o_value;
+            if (count) { memcpy(obj->values, &values[frame.start], count * sizeof(jf_Node*)); }
+            obj->used = (uint32_t) count;
+
+            for (size_t i = frame.start; i < keys.size(); ++i) { jf_string_free(&keys[i]); }
+            keys.resize(frame.start);
+            values.resize(frame.start);
+        } else {
+            size_t count = elements.size() - frame.start;
+            if (jf_array_alloc(&frame.node->a_value, count)) { return fail(JF_NO_MEM); }
+
+            jf_Array* arr = frame.node->a_value;
+            if (count) { memcpy(arr->elements, &elements[frame.start], count * sizeof(jf_Node*)); }
+            arr->used = (uint32_t) count;
+            elements.resize(frame.start);
+        }
+
+        return true;
+    }
+
+    bool parse() {
+        // a utf-8 byte order mark is tolerated in front of the document
+        if (end - p >= 3 && memcmp(p, "\xef\xbb\xbf", 3) == 0) { p += 3; }
+
+        skip_whitespace();
+        if (!parse_value()) { return false; }
+
+        while (!stack.empty()) {
+            const Frame& top = stack.back();
+            bool object = top.node->type == JF_OBJECT;
+            size_t count = (object ? values.size() : elements.size()) - top.start;
+
+            skip_whitespace();
+            if (p == end) { return fail(JF_UNEXPECTED_EOF); }
+
+            if (*p == (object ? '}' : ']')) {
+                ++p;
+                if (!close_container()) { return false; }
+                continue;
+            }
+
+            if (count) {
+                if (*p != ',') { return fail(JF_INVALID_SYNTAX); }
+                ++p;
+                skip_whitespace();
+            }
+
+            if (object) {
+                const char* str;
+                size_t len;
+
+                if (p == end)                { return fail(JF_UNEXPECTED_EOF); }
+                if (*p != '"')               { return fail(JF_INVALID_SYNTAX); }
+                if (!string(&str, &len))     { return false; }
+
+                // a key with escapes was unescaped into scratch, which the next string reuses
+                if (str != scratch.data()) {
+                    key = jf_string_view(str, len);
+                } else if (jf_string_alloc(&key, str, len)) {
+                    return fail(JF_NO_MEM);
+                }
+
+                skip_whitespace();
+                if (p == end)                { return fail(JF_UNEXPECTED_EOF); }
+                if (*p != ':')               { return fail(JF_INVALID_SYNTAX); }
+                ++p;
+            }
+
+            skip_whitespace();
+            if (!parse_value()) { return false; }
+        }
+
+        // a '\0' after the document ends it, files padded with zeros always parsed
+        skip_whitespace();
+        return p == end || *p == '\0' || fail(JF_INVALID_SYNTAX);
+    }
+
+    // drops whatever was built before the parse stopped
+    void discard() {
+        for (jf_String& k : keys)      { jf_string_free(&k); }
+        for (jf_Node* node : values)   { jf_node_free(node); }
+        for (jf_Node* node : elements) { jf_node_free(node); }
+        if (root) { jf_node_free(root); }
+        jf_string_free(&key);
+
+        keys.clear();
+        values.clear();
+        elements.clear();
+        stack.clear();
+        root = NULL;
+    }
+};
+
+jf_Error jf_parse_from_json_buffer(jf_Node** node, const char* data, size_t size) {
+    if (!node || (!data && size)) { return JF_NO_REF; }
+
+    jf_JsonParser parser;
+    parser.p = data;
+    parser.end = data + size;
+
+    jf_Error err;
+    if (err = jf_shape_cache_open(&parser.shapes)) { return err; }
+
+    if (!parser.parse() || !parser.root) {
+        parser.discard();
+        jf_shape_cache_close(parser.shapes);
+        return parser.err ? parser.err : JF_INVALID_SYNTAX;
+    }
+
+    jf_shape_cache_close(parser.shapes);
+
+    *node = parser.root;
+    return JF_SUCCESS;
+}
+
 jf_Error jf_parse_from_json_file(jf_Node** node, jf_String path) {
-    FILE* f = fopen(path.str, "rb");
+    FILE* f = fopen(jf_string_data(&path), "rb");
     if (!f) {
         perror("fopen");
         return JF_INVALID_FILE_PATH;
@@ -107,8 +680,8 @@ jf_Error jf_parse_from_json_file(jf_Node** node, jf_String path) {
     buffer[read] = '\0';
 
     fclose(f);
-    json parsed = json::parse(buffer);
+    jf_Error err = jf_parse_from_json_buffer(node, buffer, read);
     jf_free(buffer);
 
-    return jf_from_json(parsed, node);
+    return err;
 }
\ No newline at end of file
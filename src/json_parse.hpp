@@ -6,11 +6,14 @@
 
 using json = nlohmann::json;
 
-jf_Error jf_from_json(const json& j, jf_Node** out);
+// objects with the same keys share a shape when shapes is given, otherwise each gets its own
+jf_Error jf_from_json(const json& j, jf_Node** out, jf_ShapeCache* shapes = NULL);
 
-jf_Error build_object(const json& j_obj, jf_Object* out_obj);
+jf_Error build_object(const json& j_obj, jf_Object** out, jf_ShapeCache* shapes = NULL);
 
-jf_Error build_array(const json& j_arr, jf_Array* out_arr);
+jf_Error build_array(const json& j_arr, jf_Array** out, jf_ShapeCache* shapes = NULL);
+
+jf_Error jf_parse_from_json_buffer(jf_Node** node, const char* data, size_t size);
 
 jf_Error jf_parse_from_json_file(jf_Node** node, jf_String path);
 
@@ -0,0 +1,328 @@
+#include "json_write.hpp"
+#include "string.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define JF_JSON_WRITE_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#   include <arm_neon.h>
+#   define JF_JSON_WRITE_NEON
+#endif
+
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
+
+/*
+    sink
+*/
+
+static jf_Error jf_json_flush(jf_JsonWriter* writer) {
+    if (writer->used && fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used) {
+        writer->err = JF_IO_ERROR;
+    }
+
+    writer->used = 0;
+    return writer->err;
+}
+
+// makes room for at least n more bytes, a file sink only ever needs a chunk
+static jf_Bool jf_json_reserve(jf_JsonWriter* writer, size_t n) {
+    if (writer->err) { return JF_FALSE; }
+    if (writer->used + n <= writer->capacity) { return JF_TRUE; }
+
+    if (writer->file) {
+        return (jf_Bool) (jf_json_flush(writer) == JF_SUCCESS);
+    }
+
+    size_t capacity = JF_MATH_MAX(writer->capacity * 2, writer->used + n);
+    char* buffer = (char*) jf_alloc(capacity);
+
+    if (!buffer) {
+        writer->err = JF_NO_MEM;
+        return JF_FALSE;
+    }
+
+    if (writer->used) { memcpy(buffer, writer->buffer, writer->used); }
+    jf_free(writer->buffer);
+
+    writer->buffer = buffer;
+    writer->capacity = capacity;
+
+    return JF_TRUE;
+}
+
+static void jf_json_put(jf_JsonWriter* writer, const char* data, size_t size) {
+    if (writer->used + size <= writer->capacity) {
+        memcpy(writer->buffer + writer->used, data, size);
+        writer->used += size;
+        return;
+    }
+
+    // runs longer than a chunk go out a chunk at a time
+    while (size) {
+        if (writer->used == writer->capacity && !jf_json_reserve(writer, 1)) { return; }
+        if (!writer->file && !jf_json_reserve(writer, size))                  { return; }
+
+        size_t n = JF_MATH_MIN(size, writer->capacity - writer->used);
+        memcpy(writer->buffer + writer->used, data, n);
+
+        writer->used += n;
+        data += n;
+        size -= n;
+    }
+}
+
+JF_INLINE void jf_json_put_char(jf_JsonWriter* writer, char c) {
+    if (writer->used < writer->capacity || jf_json_reserve(writer, 1)) {
+        writer->buffer[writer->used++] = c;
+    }
+}
+
+static void jf_json_put_indent(jf_JsonWriter* writer, int depth) {
+    size_t n = (size_t) depth * JF_JSON_WRITER_INDENT + 1;
+    if (!jf_json_reserve(writer, JF_MATH_MIN(n, (size_t) JF_JSON_WRITER_CHUNK))) { return; }
+
+    jf_json_put_char(writer, '\n');
+    for (size_t i = 1; i < n; ++i) { jf_json_put_char(writer, ' '); }
+}
+
+/*
+    strings
+*/
+
+JF_INLINE jf_Bool jf_json_needs_escape(unsigned char c) {
+    return (jf_Bool) (c < 0x20 || c == '"' || c == '\\');
+}
+
+JF_INLINE unsigned jf_json_lowest_bit(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned) index;
+#else
+    return (unsigned) __builtin_ctz(mask);
+#endif
+}
+
+// length of the leading run of str that can be copied as is
+static size_t jf_json_clean_run(const char* str, size_t len) {
+    size_t i = 0;
+
+#if defined(JF_JSON_WRITE_SSE2)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i slash = _mm_set1_epi8('\\');
+    const __m128i ctrl  = _mm_set1_epi8(0x1f);
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (str + i));
+
+        // min(v, 0x1f) == v only for bytes up to 0x1f, unsigned unlike _mm_cmplt_epi8
+        __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v)
+        );
+
+        unsigned mask = (unsigned) _mm_movemask_epi8(hit);
+        if (mask) { return i + jf_json_lowest_bit(mask); }
+    }
+#elif defined(JF_JSON_WRITE_NEON)
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t slash = vdupq_n_u8('\\');
+    const uint8x16_t ctrl  = vdupq_n_u8(0x20);
+
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t*) (str + i));
+        uint8x16_t hit = vorrq_u8(vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, slash)), vcltq_u8(v, ctrl));
+
+        // the scalar loop below finds where in the block it is
+        if (vmaxvq_u8(hit)) { break; }
+    }
+#endif
+
+    for (; i < len; ++i) {
+        if (jf_json_needs_escape((unsigned char) str[i])) { break; }
+    }
+
+    return i;
+}
+
+static void jf_json_put_string(jf_JsonWriter* writer, const char* str, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+
+    jf_json_put_char(writer, '"');
+
+    while (len) {
+        size_t run = jf_json_clean_run(str, len);
+        jf_json_put(writer, str, run);
+
+        str += run;
+        len -= run;
+        if (!len) { break; }
+
+        unsigned char c = (unsigned char) *str++;
+        len--;
+
+        char escape[6] = { '\\', 0, 0, 0, 0, 0 };
+        size_t escape_len = 2;
+
+        switch (c) {
+            case '"':  escape[1] = '"';  break;
+            case '\\': escape[1] = '\\'; break;
+            case '\b': escape[1] = 'b';  break;
+            case '\f': escape[1] = 'f';  break;
+            case '\n': escape[1] = 'n';  break;
+            case '\r': escape[1] = 'r';  break;
+            case '\t': escape[1] = 't';  break;
+            default: {
+                escape[1] = 'u';
+                escape[2] = '0';
+                escape[3] = '0';
+                escape[4] = hex[c >> 4];
+                escape[5] = hex[c & 0xf];
+                escape_len = 6;
+            } break;
+        }
+
+        jf_json_put(writer, escape, escape_len);
+    }
+
+    jf_json_put_char(writer, '"');
+}
+
+/*
+    values
+*/
+
+static void jf_json_put_number(jf_JsonWriter* writer, const jf_Node* node) {
+    if (node->n_type == JF_NUMBER_DOUBLE && !std::isfinite(node->n_value)) {
+        jf_json_put(writer, "null", 4);
+        return;
+    }
+
+    char buffer[JF_STRING_MAX_NUMBER];
+    jf_json_put(writer, buffer, jf_node_number_format(buffer, node));
+}
+
+static void jf_json_put_node(jf_JsonWriter* writer, const jf_Node* node, int depth) {
+    if (writer->err) { return; }
+
+    switch (node->type) {
+        case JF_NULL:   jf_json_put(writer, "null", 4); break;
+        case JF_BOOL:   node->b_value ? jf_json_put(writer, "true", 4) : jf_json_put(writer, "false", 5); break;
+        case JF_NUMBER: jf_json_put_number(writer, node); break;
+        case JF_STRING: jf_json_put_string(writer, jf_string_data(node->s_value), node->s_value->len); break;
+
+        case JF_OBJECT: {
+            const jf_Object* obj = node->o_value;
+            jf_json_put_char(writer, '{');
+
+            for (size_t i = 0; i < obj->used; ++i) {
+                if (i) { jf_json_put_char(writer, ','); }
+                if (writer->pretty) { jf_json_put_indent(writer, depth + 1); }
+
+                jf_json_put_string(writer, jf_string_data(&obj->shape->keys[i]), obj->shape->keys[i].len);
+                writer->pretty ? jf_json_put(writer, ": ", 2) : jf_json_put_char(writer, ':');
+                jf_json_put_node(writer, obj->values[i], depth + 1);
+            }
+
+            if (writer->pretty && obj->used) { jf_json_put_indent(writer, depth); }
+            jf_json_put_char(writer, '}');
+        } break;
+
+        case JF_ARRAY: {
+            const jf_Array* arr = node->a_value;
+            jf_json_put_char(writer, '[');
+
+            for (size_t i = 0; i < arr->used; ++i) {
+                if (i) { jf_json_put_char(writer, ','); }
+                if (writer->pretty) { jf_json_put_indent(writer, depth + 1); }
+
+                jf_json_put_node(writer, arr->elements[i], depth + 1);
+            }
+
+            if (writer->pretty && arr->used) { jf_json_put_indent(writer, depth); }
+            jf_json_put_char(writer, ']');
+        } break;
+
+        default: writer->err = JF_INVALID_TYPE; break;
+    }
+}
+
+/*
+    api
+*/
+
+jf_Error jf_json_writer_init(jf_JsonWriter* writer, FILE* file, jf_Bool pretty) {
+    if (!writer) { return JF_NO_REF; }
+
+    writer->file = file;
+    writer->used = 0;
+    writer->capacity = JF_JSON_WRITER_CHUNK;
+    writer->pretty = pretty;
+    writer->err = JF_SUCCESS;
+    writer->buffer = (char*) jf_alloc(writer->capacity);
+
+    if (!writer->buffer) {
+        writer->capacity = 0;
+        writer->err = JF_NO_MEM;
+    }
+
+    return writer->err;
+}
+
+jf_Error jf_json_write_node(jf_JsonWriter* writer, const jf_Node* node) {
+    if (!writer || !node) { return JF_NO_REF; }
+
+    jf_json_put_node(writer, node, 0);
+    return writer->err;
+}
+
+jf_Error jf_json_writer_finish(jf_JsonWriter* writer, char** data, size_t* size) {
+    if (!writer) { return JF_NO_REF; }
+
+    if (writer->file && !writer->err) {
+        jf_json_flush(writer);
+    }
+
+    if (!writer->file && !writer->err && data && size) {
+        *data = writer->buffer;
+        *size = writer->used;
+    } else if (writer->buffer) {
+        jf_free(writer->buffer);
+    }
+
+    writer->buffer = NULL;
+    writer->used = 0;
+    writer->capacity = 0;
+
+    return writer->err;
+}
+
+jf_Error jf_json_write_buffer(const jf_Node* node, jf_Bool pretty, char** data, size_t* size) {
+    if (!node || !data || !size) { return JF_NO_REF; }
+
+    jf_JsonWriter writer;
+    jf_json_writer_init(&writer, NULL, pretty);
+    jf_json_write_node(&writer, node);
+
+    return jf_json_writer_finish(&writer, data, size);
+}
+
+jf_Error jf_json_write_file(const jf_Node* node, jf_Bool pretty, const char* path) {
+    if (!node || !path) { return JF_NO_REF; }
+
+    FILE* f = fopen(path, "wb");
+    if (!f) { return JF_INVALID_FILE_PATH; }
+
+    jf_JsonWriter writer;
+    jf_json_writer_init(&writer, f, pretty);
+    jf_json_write_node(&writer, node);
+
+    jf_Error err = jf_json_writer_finish(&writer);
+    if (fclose(f) != 0 && !err) { err = JF_IO_ERROR; }
+
+    return err;
+}
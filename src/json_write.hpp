@@ -0,0 +1,43 @@
+#ifndef _JSON_WRITE_HPP
+#define _JSON_WRITE_HPP
+
+#include "jf.h"
+
+/*
+    json writer - jf_Node trees back out as json text
+
+    output goes through one buffer. with a file as the sink the buffer is written out
+    every JF_JSON_WRITER_CHUNK bytes, without one it grows until it holds the whole
+    document. strings are scanned 16 bytes at a time for anything that needs escaping
+    (sse2/neon when available), clean runs are copied as they are.
+
+    numbers are written by jf_node_number_format, integers as they are and doubles in the
+    shortest form that parses back to them. nan and infinity have no json spelling and are
+    written as null.
+*/
+
+#define JF_JSON_WRITER_CHUNK  0x10000
+#define JF_JSON_WRITER_INDENT 4
+
+struct jf_JsonWriter {
+    FILE* file;     // sink, NULL collects everything in buffer
+    char* buffer;
+    size_t used;
+    size_t capacity;
+    jf_Bool pretty; // one value per line, indented by JF_JSON_WRITER_INDENT
+    jf_Error err;   // first failure, whatever is written after it is dropped
+};
+
+jf_Error jf_json_writer_init(jf_JsonWriter* writer, FILE* file, jf_Bool pretty);
+
+jf_Error jf_json_write_node(jf_JsonWriter* writer, const jf_Node* node);
+
+// writes out whatever is still buffered, or without a file hands the buffer over (released with jf_free)
+jf_Error jf_json_writer_finish(jf_JsonWriter* writer, char** data = NULL, size_t* size = NULL);
+
+// jf_alloc'd, not '\0' terminated
+jf_Error jf_json_write_buffer(const jf_Node* node, jf_Bool pretty, char** data, size_t* size);
+
+jf_Error jf_json_write_file(const jf_Node* node, jf_Bool pretty, const char* path);
+
+#endif
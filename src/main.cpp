@@ -18,6 +18,14 @@
 #include "platform/tinyfiledialogs.h"
 #include "jf.h"
 #include "json_parse.hpp"
+#include "json_write.hpp"
+#include "timeline_pack.hpp"
+#include "diff_cache.hpp"
+#include "string_intern.hpp"
+#include "file_watch.hpp"
+#include "parallel.hpp"
+#include "project_log.hpp"
+#include "project_index.hpp"
 #include "stdio.h"
 #include "array"
 #include <sstream>
@@ -36,6 +44,7 @@
 */ 
 
 #include <filesystem>
+#include <mutex>
 #include <vector>
 #include <string>
 namespace fs = std::filesystem;
@@ -106,52 +115,94 @@ size_t count_json_files_recurse(const std::string& root_folder) {
     return get_json_files_in_folder(root_folder).size();
 }
 
+// walks the tree one level at a time, every folder of a level is listed on its own thread
 std::vector<std::string> find_json_files_recurse(const std::string& folder_path) {
     if (folder_path.empty()) return {};
 
     std::vector<std::string> result;
+    std::vector<std::string> level = { folder_path };
 
-    for (const auto& entry : fs::recursive_directory_iterator(folder_path)) {
-        if (entry.is_regular_file() && entry.path().extension() == ".json") {
-            result.push_back(entry.path().string());
+    while (!level.empty()) {
+        std::vector<std::vector<std::string>> files(level.size());
+        std::vector<std::vector<std::string>> folders(level.size());
+
+        jf_parallel_for(level.size(), [&](size_t i) {
+            std::error_code ec;
+
+            for (auto it = fs::directory_iterator(level[i], ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+                std::error_code type_ec;
+
+                // like recursive_directory_iterator, folder symlinks aren't followed
+                if (it->is_symlink(type_ec) && it->is_directory(type_ec)) continue;
+
+                if (it->is_directory(type_ec)) {
+                    folders[i].push_back(it->path().string());
+                } else if (it->is_regular_file(type_ec) && it->path().extension() == ".json") {
+                    files[i].push_back(it->path().string());
+                }
+            }
+        });
+
+        level.clear();
+        for (size_t i = 0; i < files.size(); ++i) {
+            result.insert(result.end(), files[i].begin(), files[i].end());
+            level.insert(level.end(), folders[i].begin(), folders[i].end());
         }
     }
 
     return result;
 }
 
-// this is a disgrace (thank good ol GPT)
+// seeds every timeline pack with a timestamped first version, one thread per pack
 void copy_json_files_to_project_structure(const std::vector<std::string>& json_paths, const std::string& dest_dir) {
-    try {
-        fs::create_directories(dest_dir); // ensure the destination directory exists
+    std::error_code ec;
+    fs::create_directories(dest_dir, ec);
+    if (ec) {
+        fprintf(stderr, "Error: %s\n", ec.message().c_str());
+        return;
+    }
 
-        for (const auto& json_path_str : json_paths) {
-            fs::path json_path(json_path_str);
+    // files with the same name share a timeline, they have to go through one writer
+    std::map<std::string, std::vector<std::string>> packs;
+    for (const std::string& json_path : json_paths) {
+        std::string folder_name = fs::path(json_path).stem().string() + ".tml";
+        packs[(fs::path(dest_dir) / folder_name).string()].push_back(json_path);
+    }
 
-            if (!fs::exists(json_path) || json_path.extension() != ".json") {
-                std::cerr << "Skipping invalid JSON file: " << json_path << "\n";
+    std::vector<std::pair<std::string, std::vector<std::string>>> work(packs.begin(), packs.end());
+    uint64_t id = jf_pack_next_id();
+
+    jf_parallel_for(work.size(), [&](size_t i) {
+        std::error_code ec;
+        const std::string& folder_path = work[i].first;
+
+        fs::create_directories(folder_path, ec);
+        std::string target_file = (fs::path(folder_path) / JF_PACK_FILE_NAME).string();
+
+        jf_PackWriter* writer = NULL;
+        if (ec || jf_pack_writer_open(&writer, target_file.c_str()) != JF_SUCCESS) {
+            fprintf(stderr, "Failed to open pack: %s\n", target_file.c_str());
+            return;
+        }
+
+        for (const std::string& json_path : work[i].second) {
+            if (fs::path(json_path).extension() != ".json") {
+                fprintf(stderr, "Skipping invalid JSON file: %s\n", json_path.c_str());
                 continue;
             }
 
-            std::string folder_name = json_path.stem().string() + ".tml";
-            fs::path folder_path = fs::path(dest_dir) / folder_name;
-            fs::create_directories(folder_path);
-
-            // Generate timestamped filename
-            std::time_t now = std::time(nullptr);
-            std::string timestamp_filename = std::to_string(now) + ".json";
-            fs::path target_file = folder_path / timestamp_filename;
+            if (jf_pack_writer_append_file(writer, id, JF_PACK_JSON, json_path.c_str()) != JF_SUCCESS) {
+                fprintf(stderr, "Failed to copy: %s\n", json_path.c_str());
+                continue;
+            }
 
-            // Copy contents
-            std::ifstream src(json_path, std::ios::binary);
-            std::ofstream dst(target_file, std::ios::binary);
-            dst << src.rdbuf();
+            printf("Copied: %s -> %s\n", json_path.c_str(), target_file.c_str());
+        }
 
-            std::cout << "Copied: " << json_path << " -> " << target_file << "\n";
+        if (jf_pack_writer_close(writer) != JF_SUCCESS) {
+            fprintf(stderr, "Failed to write to pack: %s\n", target_file.c_str());
         }
-    } catch (const std::exception& ex) {
-        std::cerr << "Error: " << ex.what() << "\n";
-    }
+    });
 }
 
 bool draw_fullwidth_buttons(
@@ -174,27 +225,10 @@ bool draw_fullwidth_buttons(
 
 std::string get_value_string(jf_Node* node) {
     switch (node->type) {
-        case (JF_STRING) : return std::string(node->s_value.str);
+        case (JF_STRING) : return std::string(jf_string_data(node->s_value), node->s_value->len);
         case JF_NUMBER: {
-            std::ostringstream oss;
-            oss.precision(10); // enough precision to retain meaningful digits
-            oss << std::fixed << node->n_value;
-            std::string num_str = oss.str();
-
-            // Trim trailing zeros
-            size_t dot = num_str.find('.');
-            if (dot != std::string::npos) {
-                size_t end = num_str.find_last_not_of('0');
-                if (end != std::string::npos) {
-                    if (num_str[end] == '.') {
-                        num_str = num_str.substr(0, end); // trim dot too
-                    } else {
-                        num_str = num_str.substr(0, end + 1);
-                    }
-                }
-            }
-
-            return num_str;
+            char buffer[JF_STRING_MAX_NUMBER];
+            return std::string(buffer, jf_node_number_format(buffer, node));
         }
         case (JF_OBJECT) : return "<object>";
         case (JF_ARRAY)  : return "<array>";
@@ -217,41 +251,14 @@ ImU32 calculate_diff_color(jf_TreeDiff type) {
     return square_color;
 }
 
-bool is_valid_json_string(const std::string& str) {
-    try {
-        auto _ = nlohmann::json::parse(str); // explicitly use the result
-        return true;
-    } catch (...) {
-        return false;
-    }
-}
-
-std::string fnv1a_hash_str(const std::string& str) {
+// hash used by projects saved before tracked_hashes were jf_hash_bytes integers
+std::string fnv1a_hash_str(const char* data, size_t size) {
     constexpr uint64_t FNV_OFFSET = 14695981039346656037ULL;
     constexpr uint64_t FNV_PRIME  = 1099511628211ULL;
 
     uint64_t hash = FNV_OFFSET;
-    for (char c : str) {
-        hash ^= static_cast<unsigned char>(c);
-        hash *= FNV_PRIME;
-    }
-
-    std::stringstream ss;
-    ss << std::hex << hash;
-    return ss.str();
-}
-
-std::string fnv1a_hash_file(const std::string& path) {
-    constexpr uint64_t FNV_OFFSET = 14695981039346656037ULL;
-    constexpr uint64_t FNV_PRIME  = 1099511628211ULL;
-
-    std::ifstream in(path, std::ios::binary);
-    if (!in.is_open()) return "";
-
-    uint64_t hash = FNV_OFFSET;
-    char c;
-    while (in.get(c)) {
-        hash ^= static_cast<unsigned char>(c);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
         hash *= FNV_PRIME;
     }
 
@@ -351,11 +358,11 @@ void render_diff_tree(
 
         if (
             root->key && 
-            root->key->str
+            jf_string_data(root->key)
         ) {
 
             // Push current key into path
-            path.push_back(root->key->str);
+            path.push_back(jf_string_data(root->key));
 
             // fuck std::lib
             bool diff_matches = std::find(diff_filters.begin(), diff_filters.end(), root->type) != diff_filters.end();
@@ -373,7 +380,7 @@ void render_diff_tree(
             float height = ImGui::GetFrameHeight();
             float full_width = ImGui::GetContentRegionAvail().x;
             
-            std::string unique_id = "##" + std::string(root->key->str) + std::to_string((uintptr_t)root);
+            std::string unique_id = "##" + std::string(jf_string_data(root->key)) + std::to_string((uintptr_t)root);
             bool pressed = ImGui::InvisibleButton(unique_id.c_str(), ImVec2(full_width, height));
             hovering = parent_hovering || ImGui::IsItemHovered();
             
@@ -431,7 +438,7 @@ void render_diff_tree(
             float box_width = (full_width - (box_spacing * (box_count - 1))) / box_count;
             x_indent = pos.x; // reset x_indent for this row
 
-            render_clipped_box(root->key->str, box_width);
+            render_clipped_box(jf_string_data(root->key), box_width);
 
             if (root->node_a) {
                 render_clipped_box(jf_type_str(root->node_a->type), box_width);
@@ -459,6 +466,19 @@ void render_diff_tree(
     ImGui::Unindent(depth * indentation_depth);
 }
 
+// a version that was just parsed and stored, waiting to be handed to the open timeline
+struct ProjectCapture {
+    std::string timeline_name;
+    uint64_t id;
+    jf_Node* node;
+};
+
+// a burst of writes to one source file that hasn't settled yet
+struct ProjectPending {
+    std::chrono::steady_clock::time_point first;
+    std::chrono::steady_clock::time_point last;
+};
+
 struct Project {
     size_t last_file_count = 0;
     std::string project_name = "pick a project";
@@ -467,10 +487,68 @@ struct Project {
     std::string project_path = "";
     std::string originating_path = "";
     std::set<std::string> tracked_files = {};
-    std::map<std::string, std::string> tracked_hashes = {};
+    std::map<std::string, uint64_t> tracked_hashes = {};
+    std::map<std::string, uint64_t> canonical_hashes = {}; // jf_node_canonical_hash of the last stored version
     std::map<std::string, std::string> project_folders = {};
+    FileWatch watch;
+    ProjectLog log;
+
+    // the fold thread appends to the index, everything else touches it from the ui thread
+    ProjectIndex index;
+    std::mutex index_mutex;
+    std::vector<ProjectCapture> captures = {};
+
+    // write coalescing, a file is captured once it has been quiet for its settle window
+    // but never later than max_latency_ms after the first write of a burst
+    // skip versions that only change formatting, key order or number spelling
+    bool canonical_capture = true;
+
+    int settle_ms = 150;
+    int max_latency_ms = 2000;
+    std::map<std::string, int> settle_overrides = {};
+    std::map<std::string, ProjectPending> pending = {};
+
+    // diffs between versions, shared by every timeline of the project
+    jf_DiffCache* diff_cache = NULL;
+    int diff_cache_mb = 256;
+
+    // the selected timeline is loaded a window at a time, as many versions as fit in resident_mb
+    int resident_mb = 512;
+    size_t window_total = 0; // versions the selected timeline has, loaded or not
+
+    // keys, short values and shapes of every loaded version, one table per project.
+    // every tree interned into it has to be freed before the project is switched
+    jf_InternTable* strings = NULL;
+
+    ~Project() {
+        if (diff_cache) jf_diff_cache_close(diff_cache);
+        if (strings) jf_intern_close(strings);
+    }
+
+    void open_strings() {
+        if (strings) jf_intern_close(strings);
+        strings = NULL;
+
+        if (jf_intern_open(&strings) != JF_SUCCESS) {
+            printf("failed to open the string table, versions won't be interned\n");
+        }
+    }
+
+    void open_diff_cache() {
+        if (diff_cache) jf_diff_cache_close(diff_cache);
+        diff_cache = NULL;
+
+        std::string folder = project_path + "/diffs";
+        if (jf_diff_cache_open(&diff_cache, folder.c_str(), (uint64_t) diff_cache_mb << 20) != JF_SUCCESS) {
+            printf("failed to open the diff cache at %s\n", folder.c_str());
+        }
+    }
 
     void create(std::string folder) {
+        flush_log();
+        log.close();
+        open_strings();
+
         printf("creating project from folder: %s\n", folder.c_str());
         std::vector<std::string> found_files = find_json_files_recurse(folder);
         for (std::string f : found_files) {
@@ -487,24 +565,187 @@ struct Project {
         originating_path = folder;
         compute_latest_file_hashes();
         save();
+
+        {
+            std::lock_guard<std::mutex> lock(index_mutex);
+            index.timelines.clear();
+        }
+
+        open_diff_cache();
+
+        std::vector<ProjectLogRecord> recovered;
+        log.on_folded = [this](const std::string& name, const std::string& pack_path) { index_catch_up(name, pack_path); };
+        log.open(project_path, recovered);
     }
 
     void import(std::string path) {
+        flush_log();
+        log.close();
+        open_strings();
+
         std::ifstream in(path + "/project.json");
         if (!in.is_open()) return;
 
         json j;
         in >> j;
 
-        selected_path    = j.value("selected_path",    "");
-        project_path     = j.value("project_path",     "");
-        originating_path = j.value("originating_path", "");
-        last_file_count  = j.value("last_file_count",   0);
-        project_name     = j.value("project_name",     "pick a project");
-        selected_name    = j.value("selected_name",    "pick a timeline");
-        tracked_files    = j.value("tracked_files",    std::set<std::string>{});
-        project_folders  = j.value("project_folders",  std::map<std::string, std::string>{});
-        tracked_hashes   = j.value("tracked_hashes",   std::map<std::string, std::string>{});
+        selected_path     = j.value("selected_path",     "");
+        project_path      = j.value("project_path",      "");
+        originating_path  = j.value("originating_path",  "");
+        last_file_count   = j.value("last_file_count",   0);
+        project_name      = j.value("project_name",      "pick a project");
+        selected_name     = j.value("selected_name",     "pick a timeline");
+        tracked_files     = j.value("tracked_files",     std::set<std::string>{});
+        project_folders   = j.value("project_folders",   std::map<std::string, std::string>{});
+        canonical_hashes  = j.value("canonical_hashes",  std::map<std::string, uint64_t>{});
+        canonical_capture = j.value("canonical_capture", true);
+        settle_ms         = j.value("settle_ms",         150);
+        max_latency_ms    = j.value("max_latency_ms",    2000);
+        settle_overrides  = j.value("settle_overrides",  std::map<std::string, int>{});
+        diff_cache_mb     = j.value("diff_cache_mb",     256);
+        resident_mb       = j.value("resident_mb",       512);
+        pending.clear();
+        import_hashes(j.value("tracked_hashes", json::object()));
+
+        // convert loose per version files from older projects
+        for (auto& [name, folder] : project_folders) {
+            jf_Error err = jf_pack_import_legacy(folder.c_str());
+            if (err != JF_SUCCESS) {
+                printf("failed to pack legacy timeline %s: ", name.c_str());
+                jf_print_error(err);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(index_mutex);
+            index.load(project_path);
+        }
+
+        open_diff_cache();
+
+        // replay whatever the last session committed but didn't fold, then fold it right away
+        std::vector<ProjectLogRecord> recovered;
+        log.on_folded = [this](const std::string& name, const std::string& pack_path) { index_catch_up(name, pack_path); };
+        if (log.open(project_path, recovered)) {
+            for (const ProjectLogRecord& record : recovered) {
+                replay(record);
+            }
+
+            flush_log();
+        }
+    }
+
+    void replay(const ProjectLogRecord& record) {
+        switch (record.type) {
+            case PROJECT_LOG_HASH: {
+                tracked_hashes[record.name] = record.hash;
+                canonical_hashes[record.name] = record.canonical;
+            } break;
+
+            case PROJECT_LOG_TRACK: {
+                tracked_files.insert(record.name);
+                project_folders.insert({ record.data, project_path + "/" + record.data });
+                last_file_count = tracked_files.size();
+            } break;
+
+            default: break;
+        }
+    }
+
+    // summarizes whatever a pack has beyond what the index knows, runs on the fold thread
+    void index_catch_up(const std::string& name, const std::string& pack_path) {
+        size_t known = 0;
+        {
+            std::lock_guard<std::mutex> lock(index_mutex);
+            known = index.timelines[name].versions.size();
+        }
+
+        std::vector<VersionSummary> summaries;
+        if (!project_index_scan(pack_path, known, summaries)) return;
+
+        std::lock_guard<std::mutex> lock(index_mutex);
+        std::vector<VersionSummary>& versions = index.timelines[name].versions;
+        if (versions.size() == known) {
+            versions.insert(versions.end(), summaries.begin(), summaries.end());
+        }
+    }
+
+    // a fully loaded timeline already has every diff, the index is refreshed from it if it fell behind
+    void index_rebuild(const std::string& name, const jf_TimelineContext* context) {
+        if (!context) return;
+
+        std::lock_guard<std::mutex> lock(index_mutex);
+        std::vector<VersionSummary>& versions = index.timelines[name].versions;
+
+        uint64_t last_id = context->size ? strtoull(jf_string_data(&context->files[context->size - 1]), NULL, 10) : 0;
+        if (versions.size() == context->size && (versions.empty() || versions.back().id == last_id)) return;
+
+        versions.assign(context->size, VersionSummary());
+        for (size_t i = 0; i < context->size; ++i) {
+            versions[i].id = strtoull(jf_string_data(&context->files[i]), NULL, 10);
+            versions[i].hash = jf_node_canonical_hash(context->nodes[i]);
+            project_index_summarize(context->diffs[i], versions[i]);
+        }
+    }
+
+    // commits this frame's captures, and folds them into the packs once enough piled up
+    void sync_log() {
+        if (!log.is_open()) return;
+
+        log.commit();
+
+        if (log.fold_finished()) {
+            save();
+            log.fold_discard();
+        }
+
+        if (log.should_fold()) {
+            log.fold_async();
+        }
+    }
+
+    // blocks until everything committed is in the packs, before reading one or leaving the project
+    void flush_log() {
+        if (!log.is_open()) return;
+
+        log.commit();
+
+        // a fold that was already running, then one for everything committed since
+        log.fold_wait();
+        if (log.fold_finished()) {
+            save();
+            log.fold_discard();
+        }
+
+        log.fold_async();
+        log.fold_wait();
+        if (log.fold_finished()) {
+            save();
+            log.fold_discard();
+        }
+    }
+
+    void import_hashes(const json& hashes) {
+        tracked_hashes.clear();
+
+        for (auto it = hashes.begin(); it != hashes.end(); ++it) {
+            if (it.value().is_number_unsigned()) {
+                tracked_hashes[it.key()] = it.value().get<uint64_t>();
+                continue;
+            }
+
+            if (!it.value().is_string()) continue;
+
+            // legacy fnv1a hex string, carry it over only if the file still matches it
+            jf_FileMap map;
+            if (jf_file_read(&map, it.key().c_str()) != JF_SUCCESS) continue;
+
+            if (fnv1a_hash_str(map.data, map.size) == it.value().get<std::string>()) {
+                tracked_hashes[it.key()] = jf_hash_bytes(map.data, map.size);
+            }
+
+            jf_file_map_close(&map);
+        }
     }
 
     void save() {
@@ -518,124 +759,303 @@ struct Project {
         j["selected_path"] = selected_path;
         j["last_file_count"] = last_file_count;
         j["originating_path"] = originating_path;
+        j["canonical_hashes"] = canonical_hashes;
+        j["canonical_capture"] = canonical_capture;
+        j["settle_ms"] = settle_ms;
+        j["max_latency_ms"] = max_latency_ms;
+        j["settle_overrides"] = settle_overrides;
+        j["diff_cache_mb"] = diff_cache_mb;
+        j["resident_mb"] = resident_mb;
 
         std::ofstream out(project_path + "/project.json");
         out << j.dump(4); // pretty print with indent
+
+        std::lock_guard<std::mutex> lock(index_mutex);
+        index.save(project_path);
     }
 
-    // this is really bad but its ok
     void compute_latest_file_hashes() {
         tracked_hashes.clear();
 
-        for (auto& path : tracked_files) {
-            std::string file_data;
-            std::string file_hash;
+        std::vector<std::string> paths(tracked_files.begin(), tracked_files.end());
+        std::vector<uint64_t> hashes(paths.size());
 
+        jf_parallel_for(paths.size(), [&](size_t i) {
             // if file doesnt exist hash empty json
-            std::ifstream in(path, std::ios::in | std::ios::binary);
-            if (!in) {
-                file_data = "{}";
-            } else {
-                std::ostringstream ss;
-                ss << in.rdbuf();
-                file_data = ss.str();
+            if (jf_hash_file(paths[i].c_str(), &hashes[i]) != JF_SUCCESS) {
+                hashes[i] = jf_hash_bytes("{}", 2);
             }
+        });
+
+        for (size_t i = 0; i < paths.size(); ++i) {
+            tracked_hashes[paths[i]] = hashes[i];
+        }
+    }
+
+    // gives a newly found source file its timeline folder
+    bool track_file(const std::string& path) {
+        if (tracked_files.count(path)) return false;
+
+        printf("new file found %s\n", path.c_str());
+
+        fs::path fpath = fs::path(path);
+        std::string name = fpath.replace_extension(".tml").filename().string();
+        std::string local_path = project_path + "/" + name;
+
+        fs::create_directory(local_path);
+
+        tracked_files.insert(path);
+        project_folders.insert({name, local_path});
+        last_file_count = tracked_files.size();
+        log.append({ PROJECT_LOG_TRACK, 0, 0, 0, path, name });
+
+        return true;
+    }
+
+    // appends the current state of a tracked file to its timeline if it changed
+    bool capture_file(const std::string& path) {
+        std::string folder_name = fs::path(path).stem().string() + ".tml";
+        std::string timeline_dir = project_path + "/" + folder_name;
+        fs::create_directory(timeline_dir);
+
+        if (!fs::exists(timeline_dir) || !fs::is_directory(timeline_dir)) {
+            return false;
+        }
+
+        // if file doesnt exist hash empty json
+        jf_FileMap map;
+        const char* file_data = "{}";
+        size_t file_size = 2;
+
+        bool loaded = jf_file_read(&map, path.c_str()) == JF_SUCCESS;
+        if (loaded) {
+            file_data = map.data;
+            file_size = map.size;
+        }
+
+        // unchanged content never gets parsed
+        uint64_t file_hash = jf_hash_bytes(file_data, file_size);
+        auto known = tracked_hashes.find(path);
+
+        if (known != tracked_hashes.end() && known->second == file_hash) {
+            if (loaded) jf_file_map_close(&map);
+            return false;
+        }
+
+        // the one and only parse, doubles as validation
+        jf_Node* node = NULL;
+        if (jf_parse_from_json_buffer(&node, file_data, file_size) != JF_SUCCESS) {
+            if (loaded) jf_file_map_close(&map);
+            return false;
+        }
 
+        // reformatted or reordered but otherwise the same document, not a new version
+        uint64_t canonical_hash = jf_node_canonical_hash(node);
+        auto canonical = canonical_hashes.find(path);
+
+        if (canonical_capture && canonical != canonical_hashes.end() && canonical->second == canonical_hash) {
+            if (loaded) jf_file_map_close(&map);
+            jf_node_free(node);
             tracked_hashes[path] = file_hash;
+            log.append({ PROJECT_LOG_HASH, 0, file_hash, canonical_hash, path, "" });
+            return false;
         }
+
+        // goes out with the next group commit, the pack catches up when the log is folded
+        uint64_t id = jf_pack_next_id();
+        log.append({ PROJECT_LOG_VERSION, id, file_hash, canonical_hash, folder_name, std::string(file_data, file_size) });
+        log.append({ PROJECT_LOG_HASH, 0, file_hash, canonical_hash, path, "" });
+        if (loaded) jf_file_map_close(&map);
+
+        tracked_hashes[path] = file_hash;
+        canonical_hashes[path] = canonical_hash;
+        captures.push_back({ folder_name, id, node });
+        return true;
     }
 
-    bool check_timeline() {
-        if (project_path.empty()) return false;
-        if (originating_path.empty()) return false;
+    // tracked file a timeline was captured from, empty if it isn't tracked anymore
+    std::string source_path(const std::string& name) const {
+        for (const std::string& path : tracked_files) {
+            if (fs::path(path).stem().string() + ".tml" == name) return path;
+        }
 
-        bool updated = false;
+        return "";
+    }
 
-        // look for new files
-        // WHAT THE FUCK EVEN IS THIS IAN? - ian
-        fs::path path_to_watch(originating_path);
-        if (fs::exists(path_to_watch) && fs::is_directory(path_to_watch)) {
-            std::vector<std::string> existing_files = find_json_files_recurse(originating_path);
-            size_t new_file_count = existing_files.size();
-            
-            if (new_file_count != last_file_count) {
-                for (const std::string& new_path : existing_files) {
-                    if (!tracked_files.count(new_path)) {
-                        printf("new file found %s\n", new_path.c_str());
+    // puts a tracked file back the way it was at a version of its timeline, the restore becomes the newest version
+    bool restore(const std::string& name, size_t version) {
+        std::string source = source_path(name);
+        if (source.empty()) return false;
 
-                        fs::path fpath = fs::path(new_path);
-                        std::string name = fpath.replace_extension(".tml").filename().string();
-                        std::string local_path = project_path + "/" + name;
+        // the version, and everything captured after it, has to be in the pack first
+        flush_log();
 
-                        fs::create_directory(local_path);
+        std::string pack_path = project_path + "/" + name + "/" + JF_PACK_FILE_NAME;
+        uint64_t id = 0;
 
-                        tracked_files.insert(new_path);
-                        project_folders.insert({name, local_path});
-                        last_file_count = new_file_count;
-                        updated = true;
-                    }
-                }
+        jf_Error err = jf_pack_restore(pack_path.c_str(), version, source.c_str(), &id);
+        if (err != JF_SUCCESS) {
+            jf_print_error(err);
+            return false;
+        }
+
+        jf_Pack* pack = NULL;
+        jf_Pack* snapshots = NULL;
+        size_t at = 0;
+
+        if (jf_pack_open(&pack, pack_path.c_str()) != JF_SUCCESS) return false;
+        if (jf_pack_find(pack, id, &at) != JF_SUCCESS) {
+            jf_pack_close(pack);
+            return false;
+        }
+
+        std::string snapshot_path = project_path + "/" + name + "/" + JF_PACK_SNAPSHOT_NAME;
+        jf_pack_open(&snapshots, snapshot_path.c_str());
+
+        // the pack hashes payloads the same way files are hashed, the watcher finds the file unchanged
+        uint64_t file_hash = pack->index[at].hash;
+        uint64_t canonical_hash = 0;
+        bool summarized = false;
+
+        {
+            std::lock_guard<std::mutex> lock(index_mutex);
+            const std::vector<VersionSummary>& versions = index.timelines[name].versions;
+
+            if (version < versions.size()) {
+                canonical_hash = versions[version].hash;
+                summarized = true;
             }
         }
 
+        // only the timeline on screen needs the node, anything else just needs its hash
+        jf_Node* node = NULL;
+        if (name == selected_name || !summarized) {
+            jf_pack_load_node(pack, snapshots, at, &node, JF_FALSE);
+            if (node && !summarized) canonical_hash = jf_node_canonical_hash(node);
+        }
+
+        if (snapshots) jf_pack_close(snapshots);
+        jf_pack_close(pack);
+
+        pending.erase(source);
+        tracked_hashes[source] = file_hash;
+        canonical_hashes[source] = canonical_hash;
+        log.append({ PROJECT_LOG_HASH, 0, file_hash, canonical_hash, source, "" });
+        log.commit();
+
+        index_catch_up(name, pack_path);
+
+        if (node && name != selected_name) {
+            jf_node_free(node);
+        } else if (node) {
+            captures.push_back({ name, id, node });
+        }
+
+        printf("restored %s to version %zu\n", source.c_str(), version);
+        return true;
+    }
+
+    // full pass over the source tree, for startup and when the watch dropped events
+    bool check_all_files() {
+        bool updated = false;
+
+        for (const std::string& path : find_json_files_recurse(originating_path)) {
+            updated |= track_file(path);
+        }
+
         for (auto& path : tracked_files) {
-            std::string filename = fs::path(path).filename().string();
-            std::string folder_name = fs::path(path).stem().string() + ".tml";
-            std::string timeline_dir = project_path + "/" + folder_name;
-            fs::create_directory(timeline_dir);
+            updated |= capture_file(path);
+        }
 
-            if (!fs::exists(timeline_dir) || !fs::is_directory(timeline_dir)) {
-                continue;
-            }
+        return updated;
+    }
+
+    void defer_capture(const std::string& path, std::chrono::steady_clock::time_point now) {
+        auto it = pending.find(path);
+        if (it == pending.end()) {
+            pending[path] = { now, now };
+        } else {
+            it->second.last = now;
+        }
+    }
 
-            std::string file_data;
-            std::string file_hash;
+    // captures every pending file whose burst is over, or has gone on for too long
+    bool capture_settled(std::chrono::steady_clock::time_point now) {
+        bool updated = false;
 
-            // if file doesnt exist hash empty json
-            std::ifstream in(path, std::ios::in | std::ios::binary);
-            if (!in) {
-                file_data = "{}";
-            } else {
-                std::ostringstream ss;
-                ss << in.rdbuf();
-                file_data = ss.str();
-            }
+        for (auto it = pending.begin(); it != pending.end(); ) {
+            auto override_it = settle_overrides.find(it->first);
+            int settle = override_it != settle_overrides.end() ? override_it->second : settle_ms;
 
-            if (!is_valid_json_string(file_data)) {
+            bool settled = now - it->second.last  >= std::chrono::milliseconds(settle);
+            bool overdue = now - it->second.first >= std::chrono::milliseconds(max_latency_ms);
+
+            if (!settled && !overdue) {
+                ++it;
                 continue;
             }
 
-            file_hash = fnv1a_hash_str(file_data);
-
-            if (tracked_hashes[path] != file_hash) {
-                tracked_hashes[path] = file_hash;
-                fs::path file_path = fs::path(timeline_dir) / (std::to_string(std::time(nullptr)) + ".json");
-                std::string file_path_str = file_path.string();
-                std::ofstream out(file_path, std::ios::out | std::ios::binary);
-                if (out) {
-                    out.write(file_data.data(), file_data.size());
-                    updated = true;
-                } else {
-                    std::cerr << "Failed to write to file: " << file_path << "\n";
-                }
+            updated |= capture_file(it->first);
+            it = pending.erase(it);
+        }
+
+        return updated;
+    }
+
+    bool check_timeline() {
+        if (project_path.empty()) return false;
+        if (originating_path.empty()) return false;
+
+        bool updated = false;
+
+        // (re)start watching when the project changes and catch up on whatever changed while we weren't looking
+        if (watch.root != originating_path) {
+            if (!watch.open(originating_path)) return false;
+            updated |= check_all_files();
+        }
+
+        std::vector<FileWatchEvent> events;
+        watch.poll(events);
+
+        auto now = std::chrono::steady_clock::now();
+
+        for (const FileWatchEvent& event : events) {
+            switch (event.type) {
+                case FILE_WATCH_RESCAN: {
+                    pending.clear();
+                    updated |= check_all_files();
+                } break;
+
+                case FILE_WATCH_CHANGED: {
+                    updated |= track_file(event.path);
+                    defer_capture(event.path, now);
+                } break;
+
+                // a deleted file is recorded as an empty version, unless it comes back within the window
+                case FILE_WATCH_REMOVED: {
+                    if (tracked_files.count(event.path)) {
+                        defer_capture(event.path, now);
+                    }
+                } break;
             }
         }
 
-        if (updated) { save(); }
+        if (!pending.empty()) {
+            updated |= capture_settled(now);
+        }
+
+        sync_log();
         return updated;
     }
 };
 
-void update_diff_tree(
-    Project& project, 
-    jf_TimelineContext*& timeline_context, 
+// drops the loaded window, its trees point into the project's string table
+void close_diff_tree(
+    jf_TimelineContext*& timeline_context,
     jf_Timeline*& timeline,
     jf_Timeline*& display_node,
     jf_Timeline*& timeline_filtered
 ) {
-    jf_start();
-
-
     if (timeline_context != NULL) {
         jf_timeline_context_free(timeline_context);
         timeline_context = NULL;
@@ -643,7 +1063,7 @@ void update_diff_tree(
 
     if (timeline != NULL) {
         jf_timeline_free(timeline);
-        timeline_context = NULL;
+        timeline = NULL;
     }
 
     if (timeline_filtered != NULL) {
@@ -651,27 +1071,114 @@ void update_diff_tree(
         timeline_filtered = NULL;
     }
 
-    if (fs::exists(project.selected_path)) {
-        std::vector<std::string> files = get_json_files_in_folder(project.selected_path);
+    display_node = NULL;
+}
 
-        if (!files.empty()) {
-            // build timeline context
-            jf_timeline_context_alloc(&timeline_context, files.size());
-            for (int i = 0; i < files.size(); ++i) {
-                jf_string_alloc(&timeline_context->files[i], files[i].c_str(), files[i].size());
-            }
+void update_diff_tree(
+    Project& project, 
+    jf_TimelineContext*& timeline_context, 
+    jf_Timeline*& timeline,
+    jf_Timeline*& display_node,
+    jf_Timeline*& timeline_filtered,
+    size_t focus = SIZE_MAX // version to show, the newest one by default
+) {
+    jf_start();
 
-            // build the actual timeline
-            jf_timeline_build_from_file_names(&timeline, timeline_context);
+    // versions still in the project log aren't in the pack yet
+    project.flush_log();
 
-            jf_Timeline* cur = timeline;
+    close_diff_tree(timeline_context, timeline, display_node, timeline_filtered);
+
+    fs::path pack_path = fs::path(project.selected_path) / JF_PACK_FILE_NAME;
+    if (!project.selected_path.empty() && fs::exists(pack_path)) {
+        size_t total = 0;
+        size_t window = 0;
+
+        jf_Pack* pack = NULL;
+        if (jf_pack_open(&pack, pack_path.string().c_str()) == JF_SUCCESS) {
+            total = pack->count;
+            window = jf_pack_window_size(pack, (size_t) project.resident_mb << 20);
+            jf_pack_close(pack);
+        }
+
+        // the window is centered on the version to show, and slides back in when that runs past either end
+        size_t target = focus < total ? focus : (total ? total - 1 : 0);
+        size_t first = target > window / 2 ? target - window / 2 : 0;
+        if (first + window > total) first = total > window ? total - window : 0;
+
+        project.window_total = total;
+
+        if (total > 0) {
+            jf_Error err = jf_timeline_build_from_pack_range(&timeline, &timeline_context, pack_path.string().c_str(), first, window, project.diff_cache, project.strings);
+            if (err != JF_SUCCESS) { jf_print_error(err); }
+        }
+
+        // only a window holding the whole history has every diff
+        if (timeline_context && timeline_context->first == 0 && timeline_context->size == total) {
+            project.index_rebuild(project.selected_name, timeline_context);
+        }
+
+        jf_Timeline* cur = timeline;
+
+        while (cur && cur->next && cur->version != target) { cur = cur->next; }
+        display_node = cur;
+    }
+
+    jf_finish();
+}
+
+// hands freshly captured trees to the open timeline instead of reloading it from disk,
+// returns true if the selected timeline isn't loaded and has to be read after all
+bool append_captures(
+    Project& project,
+    jf_TimelineContext*& timeline_context,
+    jf_Timeline*& timeline,
+    jf_Timeline*& display_node
+) {
+    bool reload = false;
+    jf_start();
+
+    for (ProjectCapture& capture : project.captures) {
+        if (capture.timeline_name != project.selected_name || timeline_context == NULL) {
+            reload |= capture.timeline_name == project.selected_name;
+            jf_node_free(capture.node);
+            continue;
+        }
+
+        // an older window of the history is on screen, the capture shows up once the newest versions are loaded again
+        bool at_end = timeline_context->first + timeline_context->size == project.window_total;
+        project.window_total++;
+
+        if (!at_end) {
+            jf_node_free(capture.node);
+            continue;
+        }
+
+        // keep following the newest version if that is what was on screen
+        bool follow = display_node == NULL || display_node->next == NULL;
+
+        if (project.strings) jf_intern_node(project.strings, capture.node);
+
+        char id[JF_STRING_MAX_NUMBER];
+        jf_Error err = jf_timeline_push_node(&timeline, &timeline_context, capture.node, JF_STRING(id, jf_number_format_u64(id, capture.id)));
+
+        if (err != JF_SUCCESS) {
+            jf_print_error(err);
+            jf_node_free(capture.node);
+            continue;
+        }
 
+        if (follow) {
+            jf_Timeline* cur = timeline;
             while (cur && cur->next) { cur = cur->next; }
             display_node = cur;
         }
     }
 
+    project.captures.clear();
     jf_finish();
+
+    return reload;
 }
 
 struct Session {
@@ -758,8 +1265,14 @@ int main() {
     static bool type_filter_bool    = true;
 
     while (!glfwWindowShouldClose(window)) {
+        // version to load a window around, picked somewhere this frame and loaded once it's drawn
+        size_t jump_to = SIZE_MAX;
+        size_t restore_to = SIZE_MAX;
+
         if (current_project.check_timeline()) {
-            update_diff_tree(current_project, timeline_context, timeline, display_node, timeline_filtered);
+            if (append_captures(current_project, timeline_context, timeline, display_node)) {
+                update_diff_tree(current_project, timeline_context, timeline, display_node, timeline_filtered);
+            }
 
             if (selected_node_path.size() > 0) {
                 path_updated = true;
@@ -861,6 +1374,43 @@ int main() {
 
                 cur = cur->next;
             }
+        } else {
+            // no value picked yet, the strip summarizes every version straight from the project index
+            std::lock_guard<std::mutex> lock(current_project.index_mutex);
+            auto summary = current_project.index.timelines.find(current_project.selected_name);
+
+            if (summary != current_project.index.timelines.end()) {
+                float full_width = ImGui::GetContentRegionAvail().x;
+                float box_width = full_width / 5.0f;
+                float box_height = ImGui::GetContentRegionAvail().y * 0.9f; // fixed height
+
+                const std::vector<VersionSummary>& versions = summary->second.versions;
+                for (size_t i = 0; i < versions.size(); ++i) {
+                    const VersionSummary& version = versions[i];
+                    ImGui::PushID((int) i);
+
+                    ImGui::BeginChild(
+                        "SummaryBox",
+                        ImVec2(box_width, box_height),
+                        true
+                    );
+
+                    ImGui::Text("Version %d", (int) i);
+                    ImGui::TextDisabled("%s", project_index_time(version.id).c_str());
+                    ImGui::Separator();
+                    ImGui::Text("+%u  -%u  ~%u", version.added, version.removed, version.changed);
+                    if (ImGui::SmallButton("show")) jump_to = i;
+
+                    for (const std::string& changed_path : version.paths) {
+                        ImGui::BulletText("%s", changed_path.c_str());
+                    }
+
+                    ImGui::EndChild();
+                    ImGui::PopID();
+
+                    ImGui::SameLine(0, 8.0f); // small gap between boxes
+                }
+            }
         }
 
         ImGui::End();
@@ -881,6 +1431,7 @@ int main() {
                     std::string cwd = std::filesystem::current_path().string();
                     const char* folder = tinyfd_selectFolderDialog("Select a folder", cwd.c_str());
                     if (folder) {
+                        close_diff_tree(timeline_context, timeline, display_node, timeline_filtered);
                         current_project.import(folder);
                         session.project_path = current_project.project_path;
                         session.save();
@@ -890,6 +1441,7 @@ int main() {
                 if (ImGui::MenuItem("New Project")) {
                     const char* folder = tinyfd_selectFolderDialog("Select a folder", nullptr);
                     if (folder) {
+                        close_diff_tree(timeline_context, timeline, display_node, timeline_filtered);
                         current_project.create(folder);
                         session.project_path = current_project.project_path;
                         session.save();
@@ -945,11 +1497,57 @@ int main() {
         );
 
         if (timeline_context != NULL && timeline != NULL) {
+            size_t shown_first = timeline_context->first;
+            size_t shown_end = timeline_context->first + timeline_context->size;
+
+            if (shown_first > 0 || shown_end < current_project.window_total) {
+                ImGui::Text("versions %zu - %zu of %zu", shown_first, shown_end - 1, current_project.window_total);
+
+                if (shown_first > 0) {
+                    ImGui::SameLine();
+                    if (ImGui::SmallButton("older")) jump_to = shown_first - 1;
+                }
+
+                if (shown_end < current_project.window_total) {
+                    ImGui::SameLine();
+                    if (ImGui::SmallButton("newer")) jump_to = shown_end;
+                }
+            }
+
             render_timeline_summary(timeline, display_node, [&](jf_Timeline* selected) {
                 display_node = selected;
             });
 
             if (display_node != NULL) {
+                if (ImGui::SmallButton("restore")) ImGui::OpenPopup("ConfirmRestore");
+
+                ImGui::SameLine();
+                if (ImGui::SmallButton("export")) {
+                    const char* patterns[] = { "*.json" };
+                    std::string name = fs::path(current_project.selected_name).stem().string() + "." + std::to_string(display_node->version) + ".json";
+                    const char* path = tinyfd_saveFileDialog("Export version", name.c_str(), 1, patterns, "json files");
+
+                    // the version as it is loaded, pretty printed whatever its capture looked like
+                    if (path) {
+                        jf_Node* node = timeline_context->nodes[display_node->version - timeline_context->first];
+                        jf_print_error(jf_json_write_file(node, JF_TRUE, path));
+                    }
+                }
+
+                if (ImGui::BeginPopupModal("ConfirmRestore", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
+                    ImGui::Text("overwrite %s with version %zu?", current_project.source_path(current_project.selected_name).c_str(), display_node->version);
+
+                    if (ImGui::Button("restore")) {
+                        restore_to = display_node->version;
+                        ImGui::CloseCurrentPopup();
+                    }
+
+                    ImGui::SameLine();
+                    if (ImGui::Button("cancel")) ImGui::CloseCurrentPopup();
+
+                    ImGui::EndPopup();
+                }
+
                 render_diff_tree(display_node->entry);
             }
 
@@ -964,8 +1562,28 @@ int main() {
 
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         glfwSwapBuffers(window);
+
+        if (jump_to != SIZE_MAX) {
+            update_diff_tree(current_project, timeline_context, timeline, display_node, timeline_filtered, jump_to);
+            path_updated = selected_node_path.size() > 0;
+        }
+
+        // the restored version is appended like a capture, and shown
+        if (restore_to != SIZE_MAX && current_project.restore(current_project.selected_name, restore_to)) {
+            bool reload = append_captures(current_project, timeline_context, timeline, display_node);
+
+            if (reload || timeline_context == NULL || timeline_context->first + timeline_context->size != current_project.window_total) {
+                update_diff_tree(current_project, timeline_context, timeline, display_node, timeline_filtered);
+            } else {
+                while (display_node && display_node->next) { display_node = display_node->next; }
+            }
+
+            path_updated = selected_node_path.size() > 0;
+        }
     }
 
+    current_project.flush_log();
+
     // Cleanup
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
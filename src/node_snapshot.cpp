@@ -0,0 +1,374 @@
+#include "node_snapshot.hpp"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+#define JF_SNAPSHOT_ALIGN 8
+
+/*
+    encoding
+*/
+
+struct jf_SnapshotWriter {
+    std::vector<jf_SnapshotNode> nodes;
+    std::vector<uint32_t> links;
+    std::string strings;
+
+    // views into the tree being encoded, which outlives the writer
+    std::unordered_map<std::string_view, uint32_t> string_offsets;
+
+    bool intern(const jf_String* str, uint32_t* offset) {
+        std::string_view view(jf_string_data(str), str->len);
+
+        auto known = string_offsets.find(view);
+        if (known != string_offsets.end()) {
+            *offset = known->second;
+            return true;
+        }
+
+        if (strings.size() + view.size() + 8 > UINT32_MAX) { return false; }
+
+        uint32_t len = (uint32_t) view.size();
+        *offset = (uint32_t) strings.size();
+
+        // length, bytes, terminator, then padded so the next length is aligned
+        strings.append((const char*) &len, sizeof(len));
+        strings.append(view.data(), view.size());
+        strings.push_back('\0');
+        strings.append((4 - strings.size() % 4) % 4, '\0');
+
+        string_offsets.emplace(view, *offset);
+        return true;
+    }
+
+    // appends node and its subtree in pre order, the hashes are the ones jf_node_hash / jf_node_canonical_hash give
+    bool add(const jf_Node* node, uint64_t* hash, uint64_t* canonical) {
+        if (nodes.size() >= UINT32_MAX) { return false; }
+
+        size_t index = nodes.size();
+        nodes.push_back({ (uint32_t) node->type, 0, 0, 0 });
+
+        uint64_t h = jf_hash_combine(JF_HASH_SEED, (uint64_t) node->type);
+        uint64_t c = 0;
+
+        switch (node->type) {
+            case JF_NULL: break;
+
+            case JF_BOOL: {
+                nodes[index].value = (uint64_t) node->b_value;
+                h = jf_hash_combine(h, (uint64_t) node->b_value);
+            } break;
+
+            case JF_NUMBER: {
+                nodes[index].count = (uint32_t) node->n_type;
+                memcpy(&nodes[index].value, &node->u_value, sizeof(uint64_t));
+                h = jf_hash_combine(h, jf_node_number_bits(node));
+            } break;
+
+            case JF_STRING: {
+                uint32_t offset;
+                if (!intern(node->s_value, &offset)) { return false; }
+
+                nodes[index].value = offset;
+                h = jf_hash_combine(h, jf_string_hash(node->s_value));
+            } break;
+
+            case JF_ARRAY: {
+                const jf_Array* arr = node->a_value;
+                if (links.size() + arr->used > UINT32_MAX) { return false; }
+
+                size_t first = links.size();
+                links.resize(first + arr->used);
+                nodes[index].count = (uint32_t) arr->used;
+                nodes[index].value = first;
+
+                c = h;
+                for (size_t i = 0; i < arr->used; ++i) {
+                    uint64_t child_hash, child_canonical;
+                    links[first + i] = (uint32_t) nodes.size();
+                    if (!add(arr->elements[i], &child_hash, &child_canonical)) { return false; }
+
+                    h = jf_hash_combine(h, child_hash);
+                    c = jf_hash_combine(c, child_canonical);
+                }
+            } break;
+
+            case JF_OBJECT: {
+                const jf_Object* obj = node->o_value;
+                if (links.size() + obj->used * 2 > UINT32_MAX) { return false; }
+
+                size_t first = links.size();
+                links.resize(first + obj->used * 2);
+                nodes[index].count = (uint32_t) obj->used;
+                nodes[index].value = first;
+
+                uint64_t sum = 0;
+                for (size_t i = 0; i < obj->used; ++i) {
+                    uint64_t key_hash = jf_string_hash(&obj->shape->keys[i]);
+                    uint64_t child_hash, child_canonical;
+                    uint32_t key;
+
+                    if (!intern(&obj->shape->keys[i], &key)) { return false; }
+                    links[first + i * 2]     = key;
+                    links[first + i * 2 + 1] = (uint32_t) nodes.size();
+                    if (!add(obj->values[i], &child_hash, &child_canonical)) { return false; }
+
+                    h = jf_hash_combine(h ^ key_hash, child_hash);
+                    sum += jf_hash_combine(key_hash, child_canonical);
+                }
+
+                c = jf_hash_combine(jf_hash_combine(JF_HASH_SEED, (uint64_t) node->type) ^ (uint64_t) obj->used, sum);
+            } break;
+        }
+
+        // only containers hash differently when order is ignored
+        if (node->type != JF_ARRAY && node->type != JF_OBJECT) { c = h; }
+
+        nodes[index].hash = h;
+        *hash = h;
+        *canonical = c;
+        return true;
+    }
+};
+
+jf_Error jf_snapshot_encode(const jf_Node* node, char** data, size_t* size) {
+    if (!node || !data || !size) { return JF_NO_REF; }
+
+    jf_SnapshotWriter writer;
+    jf_SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+
+    if (!writer.add(node, &header.hash, &header.canonical)) { return JF_INDEX_OUT_OF_BOUNDS; }
+
+    header.magic       = JF_SNAPSHOT_MAGIC;
+    header.version     = JF_SNAPSHOT_VERSION;
+    header.node_count  = (uint32_t) writer.nodes.size();
+    header.link_count  = (uint32_t) writer.links.size();
+    header.string_size = (uint32_t) writer.strings.size();
+
+    size_t nodes_size = writer.nodes.size() * sizeof(jf_SnapshotNode);
+    size_t links_size = writer.links.size() * sizeof(uint32_t);
+    size_t links_pad  = (JF_SNAPSHOT_ALIGN - links_size % JF_SNAPSHOT_ALIGN) % JF_SNAPSHOT_ALIGN;
+    size_t total      = sizeof(header) + nodes_size + links_size + links_pad + writer.strings.size();
+
+    char* out = (char*) jf_calloc(1, total);
+    if (!out) { return JF_NO_MEM; }
+
+    char* at = out;
+    memcpy(at, &header, sizeof(header));                         at += sizeof(header);
+    memcpy(at, writer.nodes.data(), nodes_size);                 at += nodes_size;
+    if (links_size) { memcpy(at, writer.links.data(), links_size); }
+    at += links_size + links_pad;
+    if (!writer.strings.empty()) { memcpy(at, writer.strings.data(), writer.strings.size()); }
+
+    *data = out;
+    *size = total;
+    return JF_SUCCESS;
+}
+
+/*
+    in place access
+*/
+
+jf_Error jf_snapshot_open(jf_Snapshot* snapshot, const char* data, size_t size) {
+    if (!snapshot || !data) { return JF_NO_REF; }
+    if ((uintptr_t) data % JF_SNAPSHOT_ALIGN != 0) { return JF_INVALID_SYNTAX; }
+    if (size < sizeof(jf_SnapshotHeader))          { return JF_UNEXPECTED_EOF; }
+
+    const jf_SnapshotHeader* header = (const jf_SnapshotHeader*) data;
+    if (header->magic != JF_SNAPSHOT_MAGIC || header->version != JF_SNAPSHOT_VERSION || header->node_count == 0) {
+        return JF_INVALID_SYNTAX;
+    }
+
+    // sizes are 32 bit, none of this can overflow a 64 bit size_t
+    size_t nodes_size = (size_t) header->node_count * sizeof(jf_SnapshotNode);
+    size_t links_size = (size_t) header->link_count * sizeof(uint32_t);
+    size_t links_pad  = (JF_SNAPSHOT_ALIGN - links_size % JF_SNAPSHOT_ALIGN) % JF_SNAPSHOT_ALIGN;
+
+    if (sizeof(jf_SnapshotHeader) + nodes_size + links_size + links_pad + header->string_size > size) {
+        return JF_UNEXPECTED_EOF;
+    }
+
+    snapshot->header      = header;
+    snapshot->nodes       = (const jf_SnapshotNode*) (data + sizeof(jf_SnapshotHeader));
+    snapshot->links       = (const uint32_t*) (data + sizeof(jf_SnapshotHeader) + nodes_size);
+    snapshot->strings     = data + sizeof(jf_SnapshotHeader) + nodes_size + links_size + links_pad;
+    snapshot->string_size = header->string_size;
+
+    return JF_SUCCESS;
+}
+
+const jf_SnapshotNode* jf_snapshot_root(const jf_Snapshot* snapshot) {
+    return snapshot ? &snapshot->nodes[0] : NULL;
+}
+
+// links of a container, JF_FALSE if they run past the link table
+static jf_Bool jf_snapshot_links(const jf_Snapshot* snapshot, const jf_SnapshotNode* node, size_t per_entry, const uint32_t** links) {
+    uint64_t end = node->value + (uint64_t) node->count * per_entry;
+    if (end > snapshot->header->link_count) { return JF_FALSE; }
+
+    *links = snapshot->links + node->value;
+    return JF_TRUE;
+}
+
+static jf_Bool jf_snapshot_read_string(const jf_Snapshot* snapshot, uint64_t offset, jf_String* str) {
+    uint32_t len;
+    if (offset > snapshot->string_size || snapshot->string_size - offset < sizeof(len)) { return JF_FALSE; }
+
+    memcpy(&len, snapshot->strings + offset, sizeof(len));
+    size_t start = (size_t) offset + sizeof(len);
+    if ((uint64_t) len + 1 > snapshot->string_size - start || snapshot->strings[start + len] != '\0') { return JF_FALSE; }
+
+    *str = jf_string_view(snapshot->strings + start, len);
+    return JF_TRUE;
+}
+
+const jf_SnapshotNode* jf_snapshot_child(const jf_Snapshot* snapshot, const jf_SnapshotNode* node, size_t index) {
+    if (!snapshot || !node || index >= node->count) { return NULL; }
+
+    const uint32_t* links;
+    switch (node->type) {
+        case JF_ARRAY:  if (!jf_snapshot_links(snapshot, node, 1, &links)) { return NULL; } break;
+        case JF_OBJECT: if (!jf_snapshot_links(snapshot, node, 2, &links)) { return NULL; } links += 1; index *= 2; break;
+        default: return NULL;
+    }
+
+    if (links[index] >= snapshot->header->node_count) { return NULL; }
+    return &snapshot->nodes[links[index]];
+}
+
+jf_Bool jf_snapshot_key(const jf_Snapshot* snapshot, const jf_SnapshotNode* node, size_t index, jf_String* key) {
+    if (!snapshot || !node || !key || node->type != JF_OBJECT || index >= node->count) { return JF_FALSE; }
+
+    const uint32_t* links;
+    if (!jf_snapshot_links(snapshot, node, 2, &links)) { return JF_FALSE; }
+
+    return jf_snapshot_read_string(snapshot, links[index * 2], key);
+}
+
+jf_Bool jf_snapshot_string(const jf_Snapshot* snapshot, const jf_SnapshotNode* node, jf_String* str) {
+    if (!snapshot || !node || !str || node->type != JF_STRING) { return JF_FALSE; }
+    return jf_snapshot_read_string(snapshot, node->value, str);
+}
+
+/*
+    thawing
+*/
+
+struct jf_SnapshotThaw {
+    const jf_Snapshot* snapshot;
+    jf_Bool borrow;
+    uint32_t next; // pre order index the next node has to have, keeps damaged snapshots from sharing or looping
+
+    jf_ShapeCache* shapes;
+    std::vector<jf_String> keys; // of the object being thawed, views into the snapshot until its shape is made
+
+    jf_Error string(uint64_t offset, jf_String* out) {
+        jf_String str;
+        if (!jf_snapshot_read_string(snapshot, offset, &str)) { return JF_INVALID_SYNTAX; }
+
+        if (borrow) {
+            *out = str;
+            return JF_SUCCESS;
+        }
+
+        return jf_string_alloc(out, jf_string_data(&str), str.len);
+    }
+
+    jf_Error node(uint32_t index, jf_Node** out) {
+        if (index != next || index >= snapshot->header->node_count) { return JF_INVALID_SYNTAX; }
+        next++;
+
+        jf_Error err;
+        const jf_SnapshotNode* record = &snapshot->nodes[index];
+        jf_Node* n = NULL;
+
+        if (record->type > JF_ARRAY)                          { return JF_INVALID_TYPE; }
+        if (err = jf_node_alloc(&n, (jf_Type) record->type))  { return err; }
+
+        switch (record->type) {
+            case JF_NULL: break;
+
+            case JF_BOOL: {
+                n->b_value = record->value ? JF_TRUE : JF_FALSE;
+            } break;
+
+            case JF_NUMBER: {
+                if (record->count > JF_NUMBER_UINT) { err = JF_INVALID_SYNTAX; break; }
+
+                n->n_type = (jf_NumberType) record->count;
+                memcpy(&n->u_value, &record->value, sizeof(n->u_value));
+            } break;
+
+            case JF_STRING: {
+                err = string(record->value, n->s_value);
+            } break;
+
+            case JF_ARRAY: {
+                const uint32_t* links;
+                if (!jf_snapshot_links(snapshot, record, 1, &links)) { err = JF_INVALID_SYNTAX; break; }
+                if (err = jf_array_alloc(&n->a_value, record->count)) { break; }
+
+                jf_Array* arr = n->a_value;
+                for (uint32_t i = 0; i < record->count; ++i) {
+                    if (err = node(links[i], &arr->elements[i])) { break; }
+                    arr->used++;
+                }
+            } break;
+
+            case JF_OBJECT: {
+                const uint32_t* links;
+                if (!jf_snapshot_links(snapshot, record, 2, &links)) { err = JF_INVALID_SYNTAX; break; }
+
+                keys.resize(record->count);
+                for (uint32_t i = 0; !err && i < record->count; ++i) {
+                    if (!jf_snapshot_read_string(snapshot, links[i * 2], &keys[i])) { err = JF_INVALID_SYNTAX; }
+                }
+
+                // the shape keeps the views when borrowing, the keys only have to be copied once per shape otherwise
+                jf_Shape* shape = NULL;
+                if (err)                                                                                       { break; }
+                if (err = jf_shape_cache_get(shapes, &shape, keys.data(), record->count, (jf_Bool) !borrow)) { break; }
+                if (err = jf_object_alloc(&n->o_value, shape))                                               { break; }
+
+                // values count as used once they are in, so a failure frees exactly what was built
+                jf_Object* obj = n->o_value;
+                for (uint32_t i = 0; i < record->count; ++i) {
+                    if (err = node(links[i * 2 + 1], &obj->values[i])) { break; }
+                    obj->used++;
+                }
+            } break;
+
+            default: err = JF_INVALID_TYPE; break;
+        }
+
+        if (err) {
+            jf_node_free(n);
+            return err;
+        }
+
+        *out = n;
+        return JF_SUCCESS;
+    }
+};
+
+jf_Error jf_snapshot_thaw(const jf_Snapshot* snapshot, jf_Node** node, jf_Bool borrow) {
+    if (!snapshot || !node) { return JF_NO_REF; }
+
+    jf_SnapshotThaw thaw = { snapshot, borrow, 0, NULL, {} };
+    jf_Node* root = NULL;
+
+    jf_Error err;
+    if (err = jf_shape_cache_open(&thaw.shapes)) { return err; }
+
+    err = thaw.node(0, &root);
+    jf_shape_cache_close(thaw.shapes);
+    if (err) { return err; }
+
+    *node = root;
+    return JF_SUCCESS;
+}
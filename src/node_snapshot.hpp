@@ -0,0 +1,69 @@
+#ifndef _NODE_SNAPSHOT_HPP
+#define _NODE_SNAPSHOT_HPP
+
+#include "jf.h"
+#include <stdint.h>
+
+/*
+    node snapshot - a parsed jf_Node tree laid out flat, to be read straight from a mapping
+
+    [header] [nodes] [links] [strings]
+
+    nodes are stored in pre order, every reference is an index or an offset from the
+    start of the snapshot, so it works wherever it is mapped. each node carries its
+    jf_node_hash, the header carries the root's jf_node_hash and jf_node_canonical_hash.
+
+    containers own a run of links, one node index per array element or a key string
+    offset + node index pair per object entry. strings are deduplicated, stored as a
+    u32 length followed by the bytes and a terminating '\0' so they can be used in place.
+*/
+
+#define JF_SNAPSHOT_MAGIC   0x4e53464a // "JFSN"
+#define JF_SNAPSHOT_VERSION 1
+
+struct jf_SnapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t hash;      // jf_node_hash of the root
+    uint64_t canonical; // jf_node_canonical_hash of the root
+    uint32_t node_count;
+    uint32_t link_count;
+    uint32_t string_size;
+    uint32_t reserved;
+};
+
+struct jf_SnapshotNode {
+    uint32_t type;  // jf_Type
+    uint32_t count; // elements or entries of a container, a number's jf_NumberType
+    uint64_t value; // bool, number bits, string offset or the container's first link
+    uint64_t hash;  // jf_node_hash of the subtree
+};
+
+// validated view over snapshot bytes, nothing is copied
+struct jf_Snapshot {
+    const jf_SnapshotHeader* header;
+    const jf_SnapshotNode* nodes;
+    const uint32_t* links;
+    const char* strings;
+    size_t string_size;
+};
+
+// jf_alloc'd buffer, released with jf_free
+jf_Error jf_snapshot_encode(const jf_Node* node, char** data, size_t* size);
+
+// data has to be 8 byte aligned, pack payloads and mappings always are
+jf_Error jf_snapshot_open(jf_Snapshot* snapshot, const char* data, size_t size);
+
+const jf_SnapshotNode* jf_snapshot_root(const jf_Snapshot* snapshot);
+
+// NULL when out of range
+const jf_SnapshotNode* jf_snapshot_child(const jf_Snapshot* snapshot, const jf_SnapshotNode* node, size_t index);
+
+// borrowed strings, they live as long as the snapshot's memory does
+jf_Bool jf_snapshot_key(const jf_Snapshot* snapshot, const jf_SnapshotNode* node, size_t index, jf_String* key);
+jf_Bool jf_snapshot_string(const jf_Snapshot* snapshot, const jf_SnapshotNode* node, jf_String* str);
+
+// builds the jf_Node tree, with borrow the node's strings point into the snapshot instead of being copied
+jf_Error jf_snapshot_thaw(const jf_Snapshot* snapshot, jf_Node** node, jf_Bool borrow);
+
+#endif
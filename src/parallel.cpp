@@ -0,0 +1,31 @@
+#include "parallel.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+void jf_parallel_for(size_t count, const std::function<void(size_t)>& fn) {
+    size_t threads = std::thread::hardware_concurrency();
+    if (threads > count) { threads = count; }
+
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i) { fn(i); }
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) { fn(i); }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+
+    worker();
+
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+}
@@ -0,0 +1,13 @@
+#ifndef _PARALLEL_HPP
+#define _PARALLEL_HPP
+
+#include <stddef.h>
+#include <functional>
+
+/*
+    runs fn(0) .. fn(count - 1) on up to one thread per core
+    indices are handed out in order, so early items finish first
+*/
+void jf_parallel_for(size_t count, const std::function<void(size_t)>& fn);
+
+#endif
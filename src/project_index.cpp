@@ -0,0 +1,275 @@
+#include "project_index.hpp"
+#include "timeline_pack.hpp"
+#include "node_snapshot.hpp"
+
+#include <filesystem>
+#include <ctime>
+#include <string.h>
+
+namespace fs = std::filesystem;
+
+#define PROJECT_INDEX_MAGIC   0x4950464a // "JFPI"
+#define PROJECT_INDEX_VERSION 1
+
+/*
+    file layout, all little endian as written
+
+    u32 magic, u32 version, u64 timeline count
+    per timeline:   string name, u64 version count
+    per version:    u64 id, u64 hash, u32 added, u32 removed, u32 changed, u32 path count, string paths[]
+    string:         u32 size, bytes
+*/
+
+static void project_index_put(std::string& out, const void* data, size_t size) {
+    out.append((const char*) data, size);
+}
+
+static void project_index_put_string(std::string& out, const std::string& str) {
+    uint32_t size = (uint32_t) str.size();
+    project_index_put(out, &size, sizeof(size));
+    out.append(str);
+}
+
+// bounds checked reader over the mapped file
+struct ProjectIndexReader {
+    const char* data;
+    size_t size;
+    size_t offset;
+
+    bool get(void* out, size_t len) {
+        if (len > size - offset) { return false; }
+        memcpy(out, data + offset, len);
+        offset += len;
+        return true;
+    }
+
+    bool get_string(std::string& out) {
+        uint32_t len;
+        if (!get(&len, sizeof(len)) || len > size - offset) { return false; }
+        out.assign(data + offset, len);
+        offset += len;
+        return true;
+    }
+};
+
+bool ProjectIndex::load(const std::string& project_folder) {
+    timelines.clear();
+
+    std::string path = (fs::path(project_folder) / PROJECT_INDEX_FILE_NAME).string();
+
+    jf_FileMap map;
+    if (jf_file_map_open(&map, path.c_str()) != JF_SUCCESS) { return false; }
+
+    ProjectIndexReader reader = { map.data, map.size, 0 };
+
+    uint32_t magic = 0, version = 0;
+    uint64_t timeline_count = 0;
+    bool ok = reader.get(&magic, sizeof(magic)) && reader.get(&version, sizeof(version)) && reader.get(&timeline_count, sizeof(timeline_count));
+    ok = ok && magic == PROJECT_INDEX_MAGIC && version == PROJECT_INDEX_VERSION;
+
+    for (uint64_t t = 0; ok && t < timeline_count; ++t) {
+        std::string name;
+        uint64_t version_count = 0;
+        ok = reader.get_string(name) && reader.get(&version_count, sizeof(version_count));
+
+        // a version takes at least 32 bytes, anything claiming more than fits is damaged
+        ok = ok && version_count <= (reader.size - reader.offset) / 32;
+        if (!ok) { break; }
+
+        TimelineSummary& timeline = timelines[name];
+        timeline.versions.resize((size_t) version_count);
+
+        for (VersionSummary& summary : timeline.versions) {
+            uint32_t path_count = 0;
+            ok = reader.get(&summary.id, sizeof(summary.id))
+              && reader.get(&summary.hash, sizeof(summary.hash))
+              && reader.get(&summary.added, sizeof(summary.added))
+              && reader.get(&summary.removed, sizeof(summary.removed))
+              && reader.get(&summary.changed, sizeof(summary.changed))
+              && reader.get(&path_count, sizeof(path_count))
+              && path_count <= PROJECT_INDEX_MAX_PATHS;
+
+            for (uint32_t p = 0; ok && p < path_count; ++p) {
+                std::string changed_path;
+                ok = reader.get_string(changed_path);
+                summary.paths.push_back(changed_path);
+            }
+
+            if (!ok) { break; }
+        }
+    }
+
+    jf_file_map_close(&map);
+
+    // a damaged index is only a cache, it gets rebuilt as timelines are loaded
+    if (!ok) { timelines.clear(); }
+    return ok;
+}
+
+bool ProjectIndex::save(const std::string& project_folder) const {
+    std::string out;
+
+    uint32_t magic = PROJECT_INDEX_MAGIC;
+    uint32_t version = PROJECT_INDEX_VERSION;
+    uint64_t timeline_count = timelines.size();
+
+    project_index_put(out, &magic, sizeof(magic));
+    project_index_put(out, &version, sizeof(version));
+    project_index_put(out, &timeline_count, sizeof(timeline_count));
+
+    for (auto& [name, timeline] : timelines) {
+        uint64_t version_count = timeline.versions.size();
+        project_index_put_string(out, name);
+        project_index_put(out, &version_count, sizeof(version_count));
+
+        for (const VersionSummary& summary : timeline.versions) {
+            uint32_t path_count = (uint32_t) summary.paths.size();
+            project_index_put(out, &summary.id, sizeof(summary.id));
+            project_index_put(out, &summary.hash, sizeof(summary.hash));
+            project_index_put(out, &summary.added, sizeof(summary.added));
+            project_index_put(out, &summary.removed, sizeof(summary.removed));
+            project_index_put(out, &summary.changed, sizeof(summary.changed));
+            project_index_put(out, &path_count, sizeof(path_count));
+
+            for (const std::string& changed_path : summary.paths) {
+                project_index_put_string(out, changed_path);
+            }
+        }
+    }
+
+    // written next to the old one and swapped in, a crash leaves one or the other
+    std::string path = (fs::path(project_folder) / PROJECT_INDEX_FILE_NAME).string();
+    std::string temp_path = path + ".tmp";
+
+    FILE* f = fopen(temp_path.c_str(), "wb");
+    if (!f) { return false; }
+
+    bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+    ok = (fclose(f) == 0) && ok;
+
+    std::error_code ec;
+    if (ok) { fs::rename(temp_path, path, ec); }
+
+    return ok && !ec;
+}
+
+static void project_index_walk(const jf_DiffNode* diff, VersionSummary& summary, std::string& path) {
+    for (; diff; diff = diff->next) {
+        // list heads carry no key
+        if (!diff->key) { continue; }
+
+        size_t restore = path.size();
+        if (!path.empty()) { path += '/'; }
+        path.append(jf_string_data(diff->key), diff->key->len);
+
+        bool counted = true;
+        switch (diff->type) {
+            case JF_DIFF_ADDED:   summary.added++;   break;
+            case JF_DIFF_REMOVED: summary.removed++; break;
+
+            // a container that changed is described by its children
+            case JF_DIFF_CHANGED: {
+                if (diff->child && diff->node_a && diff->node_b && diff->node_a->type == diff->node_b->type) {
+                    project_index_walk(diff->child, summary, path);
+                    counted = false;
+                } else {
+                    summary.changed++;
+                }
+            } break;
+
+            default: counted = false; break;
+        }
+
+        if (counted && summary.paths.size() < PROJECT_INDEX_MAX_PATHS) {
+            summary.paths.push_back(path);
+        }
+
+        path.resize(restore);
+    }
+}
+
+void project_index_summarize(const jf_DiffNode* diff, VersionSummary& summary) {
+    std::string path;
+    summary.added = summary.removed = summary.changed = 0;
+    summary.paths.clear();
+
+    project_index_walk(diff, summary, path);
+}
+
+// read off the snapshot when there is one, hashed from the node otherwise
+static uint64_t project_index_hash(const jf_Pack* snapshots, uint64_t id, const jf_Node* node) {
+    size_t at;
+    jf_PackRecord record;
+    jf_Snapshot snapshot;
+
+    if (snapshots
+        && jf_pack_find(snapshots, id, &at) == JF_SUCCESS
+        && jf_pack_get(snapshots, at, &record) == JF_SUCCESS
+        && record.encoding == JF_PACK_NODE
+        && jf_snapshot_open(&snapshot, record.data, record.size) == JF_SUCCESS) {
+        return snapshot.header->canonical;
+    }
+
+    return jf_node_canonical_hash(node);
+}
+
+bool project_index_scan(const std::string& pack_path, size_t first, std::vector<VersionSummary>& summaries) {
+    jf_Pack* pack = NULL;
+    if (jf_pack_open(&pack, pack_path.c_str()) != JF_SUCCESS) { return false; }
+
+    // optional, versions without a snapshot are parsed
+    jf_Pack* snapshots = NULL;
+    std::string snapshot_path = (fs::path(pack_path).parent_path() / JF_PACK_SNAPSHOT_NAME).string();
+    jf_pack_open(&snapshots, snapshot_path.c_str());
+
+    bool ok = true;
+    jf_Node* previous = NULL;
+
+    // the version before first is only needed as the other side of the first diff
+    size_t start = first > 0 ? first - 1 : 0;
+
+    for (size_t i = start; ok && i < pack->count; ++i) {
+        uint64_t id = pack->index[i].id;
+        jf_Node* node = NULL;
+
+        ok = jf_pack_load_node(pack, snapshots, i, &node, JF_TRUE) == JF_SUCCESS;
+        if (!ok) { break; }
+
+        if (i >= first) {
+            jf_DiffNode* diff = NULL;
+            ok = jf_diff_alloc(&diff, NULL, NULL) == JF_SUCCESS;
+
+            if (ok) {
+                ok = jf_compare_object_diff(diff, previous ? previous->o_value : node->o_value, previous ? node->o_value : NULL) == JF_SUCCESS;
+
+                VersionSummary summary;
+                summary.id = id;
+                summary.hash = project_index_hash(snapshots, id, node);
+                project_index_summarize(diff, summary);
+                summaries.push_back(summary);
+
+                jf_diff_free(diff);
+            }
+        }
+
+        if (previous) { jf_node_free(previous); }
+        previous = node;
+    }
+
+    if (previous) { jf_node_free(previous); }
+    if (snapshots) { jf_pack_close(snapshots); }
+    jf_pack_close(pack);
+
+    return ok;
+}
+
+std::string project_index_time(uint64_t id) {
+    // anything past the year 33658 in seconds is a nanosecond id
+    time_t seconds = (time_t) (id > 1000000000000ULL ? id / 1000000000ULL : id);
+
+    char buffer[32];
+    struct tm* local = localtime(&seconds);
+    if (!local || !strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", local)) { return ""; }
+
+    return buffer;
+}
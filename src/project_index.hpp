@@ -0,0 +1,51 @@
+#ifndef _PROJECT_INDEX_HPP
+#define _PROJECT_INDEX_HPP
+
+#include "jf.h"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*
+    project index - what the ui needs to show a project without reading any versions
+
+    one entry per version of every timeline, its id (the capture timestamp), content
+    hash, how many values it added, removed and changed, and the first few paths it
+    touched. kept in <project>/project.jfi and rewritten whenever the project is saved.
+*/
+
+#define PROJECT_INDEX_FILE_NAME "project.jfi"
+#define PROJECT_INDEX_MAX_PATHS 8
+
+struct VersionSummary {
+    uint64_t id = 0;
+    uint64_t hash = 0; // jf_node_canonical_hash of the version
+    uint32_t added = 0;
+    uint32_t removed = 0;
+    uint32_t changed = 0;
+    std::vector<std::string> paths = {}; // "key/0/key", at most PROJECT_INDEX_MAX_PATHS
+};
+
+struct TimelineSummary {
+    std::vector<VersionSummary> versions = {};
+};
+
+struct ProjectIndex {
+    std::map<std::string, TimelineSummary> timelines = {};
+
+    bool load(const std::string& project_folder);
+    bool save(const std::string& project_folder) const;
+};
+
+// counts the changes of one version's diff against the version before it
+void project_index_summarize(const jf_DiffNode* diff, VersionSummary& summary);
+
+// summarizes pack records from first onward, diffing each against the record before it
+bool project_index_scan(const std::string& pack_path, size_t first, std::vector<VersionSummary>& summaries);
+
+// "2024-05-01 13:37:00" for a version id, ids are seconds or nanoseconds since the epoch
+std::string project_index_time(uint64_t id);
+
+#endif
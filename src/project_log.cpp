@@ -0,0 +1,406 @@
+#include "project_log.hpp"
+#include "timeline_pack.hpp"
+#include "jf.h"
+
+#include <filesystem>
+#include <map>
+#include <set>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#   include <io.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#   include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#define PROJECT_LOG_MAGIC 0x4c57464a // "JFWL"
+#define PROJECT_LOG_ALIGN 8
+
+struct ProjectLogHeader {
+    uint32_t magic;
+    uint32_t type;
+    uint64_t id;
+    uint64_t hash;
+    uint64_t canonical;
+    uint32_t name_size;
+    uint32_t reserved;
+    uint64_t data_size;
+    uint64_t checksum; // over everything above, the name and the data
+};
+
+static uint64_t project_log_checksum(const ProjectLogHeader* header, const char* name, const char* data) {
+    uint64_t h = jf_hash_bytes(header, offsetof(ProjectLogHeader, checksum));
+    h = jf_hash_combine(h, jf_hash_bytes(name, header->name_size));
+    return jf_hash_combine(h, jf_hash_bytes(data, (size_t) header->data_size));
+}
+
+static void project_log_serialize(const ProjectLogRecord& record, std::string& out) {
+    ProjectLogHeader header;
+    memset(&header, 0, sizeof(header));
+
+    header.magic     = PROJECT_LOG_MAGIC;
+    header.type      = (uint32_t) record.type;
+    header.id        = record.id;
+    header.hash      = record.hash;
+    header.canonical = record.canonical;
+    header.name_size = (uint32_t) record.name.size();
+    header.data_size = (uint64_t) record.data.size();
+    header.checksum  = project_log_checksum(&header, record.name.data(), record.data.data());
+
+    out.append((const char*) &header, sizeof(header));
+    out.append(record.name);
+    out.append(record.data);
+    out.append((PROJECT_LOG_ALIGN - out.size() % PROJECT_LOG_ALIGN) % PROJECT_LOG_ALIGN, '\0');
+}
+
+// reads a segment up to its first torn or damaged record
+static void project_log_read(const std::string& path, std::vector<ProjectLogRecord>& records) {
+    jf_FileMap map;
+    if (jf_file_map_open(&map, path.c_str()) != JF_SUCCESS) { return; }
+
+    size_t offset = 0;
+    while (offset + sizeof(ProjectLogHeader) <= map.size) {
+        ProjectLogHeader header;
+        memcpy(&header, map.data + offset, sizeof(header));
+
+        size_t remaining = map.size - offset - sizeof(header);
+        if (header.magic != PROJECT_LOG_MAGIC)                                  { break; }
+        if (header.name_size > remaining)                                       { break; }
+        if (header.data_size > remaining - header.name_size)                    { break; }
+
+        const char* name = map.data + offset + sizeof(header);
+        const char* data = name + header.name_size;
+        if (project_log_checksum(&header, name, data) != header.checksum)       { break; }
+
+        ProjectLogRecord record;
+        record.type      = (ProjectLogType) header.type;
+        record.id        = header.id;
+        record.hash      = header.hash;
+        record.canonical = header.canonical;
+        record.name.assign(name, header.name_size);
+        record.data.assign(data, (size_t) header.data_size);
+        records.push_back(std::move(record));
+
+        size_t span = sizeof(header) + header.name_size + (size_t) header.data_size;
+        offset += (span + PROJECT_LOG_ALIGN - 1) & ~(size_t) (PROJECT_LOG_ALIGN - 1);
+    }
+
+    jf_file_map_close(&map);
+}
+
+static bool project_log_flush(FILE* file) {
+    if (fflush(file) != 0) { return false; }
+
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#elif defined(__unix__) || defined(__APPLE__)
+    return fsync(fileno(file)) == 0;
+#else
+    return true;
+#endif
+}
+
+// drops a partially written batch so later commits don't end up behind a torn record
+static void project_log_truncate(FILE* file, long size) {
+#if defined(_WIN32)
+    _chsize(_fileno(file), size);
+#elif defined(__unix__) || defined(__APPLE__)
+    if (ftruncate(fileno(file), (off_t) size) != 0) {
+        JF_LOG("failed to trim the project log");
+    }
+#endif
+    fseek(file, 0, SEEK_END);
+}
+
+bool ProjectLog::open(const std::string& project_folder, std::vector<ProjectLogRecord>& recovered) {
+    close();
+
+    folder = project_folder;
+    std::string log_path  = (fs::path(folder) / PROJECT_LOG_FILE_NAME).string();
+    std::string fold_path = (fs::path(folder) / PROJECT_LOG_FOLD_NAME).string();
+
+    // an unfinished fold, whatever it didn't mark as folded still has to go into the packs
+    std::vector<ProjectLogRecord> unfolded;
+    std::vector<ProjectLogRecord> segment;
+    project_log_read(fold_path, segment);
+
+    std::set<std::string> folded;
+    for (const ProjectLogRecord& record : segment) {
+        if (record.type == PROJECT_LOG_FOLDED) { folded.insert(record.name); }
+    }
+
+    for (ProjectLogRecord& record : segment) {
+        if (record.type == PROJECT_LOG_FOLDED) { continue; }
+        if (record.type == PROJECT_LOG_VERSION && folded.count(record.name)) { continue; }
+        unfolded.push_back(std::move(record));
+    }
+
+    project_log_read(log_path, unfolded);
+
+    // versions whose id their pack already holds made it in before a crash or a failed fold, not marked or not yet
+    std::map<std::string, jf_Pack*> packs;
+    std::vector<ProjectLogRecord> pending;
+
+    for (ProjectLogRecord& record : unfolded) {
+        if (record.type == PROJECT_LOG_VERSION) {
+            auto pack = packs.find(record.name);
+            if (pack == packs.end()) {
+                std::string pack_path = (fs::path(folder) / record.name / JF_PACK_FILE_NAME).string();
+                pack = packs.insert({ record.name, NULL }).first;
+
+                std::error_code ec;
+                if (fs::exists(pack_path, ec) && jf_pack_open(&pack->second, pack_path.c_str()) != JF_SUCCESS) {
+                    pack->second = NULL;
+                }
+            }
+
+            size_t at;
+            if (pack->second && jf_pack_find(pack->second, record.id, &at) == JF_SUCCESS) { continue; }
+        }
+
+        pending.push_back(std::move(record));
+    }
+
+    for (auto& [name, pack] : packs) {
+        if (pack) { jf_pack_close(pack); }
+    }
+
+    unfolded = std::move(pending);
+
+    // both segments become one fresh segment, written before the old ones go away
+    std::string temp_path = log_path + ".tmp";
+    file = fopen(temp_path.c_str(), "wb");
+    if (!file) { return false; }
+
+    if (!write(unfolded)) {
+        fclose(file);
+        file = NULL;
+        return false;
+    }
+
+    fclose(file);
+
+    std::error_code ec;
+    fs::rename(temp_path, log_path, ec);
+    if (!ec) { fs::remove(fold_path, ec); }
+
+    file = fopen(log_path.c_str(), "ab");
+    if (!file) { return false; }
+
+    if (!unfolded.empty()) {
+        JF_LOG("recovered %zu records from the project log", unfolded.size());
+    }
+
+    for (const ProjectLogRecord& record : unfolded) {
+        committed_bytes += sizeof(ProjectLogHeader) + record.name.size() + record.data.size();
+    }
+
+    committed = unfolded;
+    recovered = std::move(unfolded);
+    last_commit = std::chrono::steady_clock::now();
+
+    return true;
+}
+
+void ProjectLog::close() {
+    fold_wait();
+
+    if (file) { fclose(file); }
+
+    // anything not yet folded stays in the segments for the next open
+    file = NULL;
+    fold_pending = false;
+    staged.clear();
+    committed.clear();
+    fold_failed.clear();
+    committed_bytes = 0;
+    folder.clear();
+}
+
+void ProjectLog::append(ProjectLogRecord record) {
+    staged.push_back(std::move(record));
+}
+
+bool ProjectLog::write(const std::vector<ProjectLogRecord>& records) {
+    if (records.empty()) { return true; }
+
+    std::string batch;
+    for (const ProjectLogRecord& record : records) {
+        project_log_serialize(record, batch);
+    }
+
+    // append mode doesn't promise a meaningful position until the first write
+    fseek(file, 0, SEEK_END);
+    long start = ftell(file);
+
+    if (fwrite(batch.data(), 1, batch.size(), file) != batch.size() || !project_log_flush(file)) {
+        if (start >= 0) { project_log_truncate(file, start); }
+        return false;
+    }
+
+    return true;
+}
+
+bool ProjectLog::commit() {
+    if (!file || staged.empty()) { return true; }
+
+    // stays staged on failure, the next commit tries again
+    if (!write(staged)) {
+        JF_LOG("failed to commit %zu records to the project log", staged.size());
+        return false;
+    }
+
+    for (ProjectLogRecord& record : staged) {
+        committed_bytes += sizeof(ProjectLogHeader) + record.name.size() + record.data.size();
+        committed.push_back(std::move(record));
+    }
+
+    staged.clear();
+    last_commit = std::chrono::steady_clock::now();
+
+    return true;
+}
+
+bool ProjectLog::should_fold() const {
+    if (!file || fold_pending || committed.empty()) { return false; }
+
+    return committed_bytes >= fold_bytes || std::chrono::steady_clock::now() - last_commit >= fold_idle;
+}
+
+// every timeline's versions go through one pack writer, the index is rewritten once per timeline
+static void project_log_fold(
+    const std::string& folder,
+    const std::vector<ProjectLogRecord>& records,
+    std::vector<ProjectLogRecord>& failed,
+    const std::function<void(const std::string&, const std::string&)>& on_folded
+) {
+    std::map<std::string, std::vector<const ProjectLogRecord*>> timelines;
+    for (const ProjectLogRecord& record : records) {
+        if (record.type == PROJECT_LOG_VERSION) { timelines[record.name].push_back(&record); }
+    }
+
+    std::string fold_path = (fs::path(folder) / PROJECT_LOG_FOLD_NAME).string();
+
+    for (auto& [name, versions] : timelines) {
+        std::error_code ec;
+        fs::path timeline_dir = fs::path(folder) / name;
+        fs::create_directories(timeline_dir, ec);
+
+        std::string pack_path = (timeline_dir / JF_PACK_FILE_NAME).string();
+
+        jf_Error err;
+        jf_Error append_err = JF_SUCCESS;
+        jf_PackWriter* writer = NULL;
+        size_t appended = 0; // versions before this one are in the pack
+
+        if (!(err = jf_pack_writer_open(&writer, pack_path.c_str()))) {
+            for (const ProjectLogRecord* version : versions) {
+                // an earlier fold got it in before it failed or crashed
+                size_t at;
+                if (jf_pack_writer_find_id(writer, version->id, &at) == JF_SUCCESS) {
+                    appended++;
+                    continue;
+                }
+
+                if (append_err = jf_pack_writer_append(writer, version->id, JF_PACK_JSON, version->data.data(), version->data.size())) { break; }
+                appended++;
+            }
+
+            err = jf_pack_writer_close(writer);
+        }
+
+        if (!err) { err = jf_file_sync(pack_path.c_str()); }
+
+        // once the index is written and synced the appended versions are stored, only the rest is retried.
+        // otherwise all of them are, and the retry skips whichever ids the pack turns out to hold
+        size_t stored = err ? 0 : appended;
+        if (!err) { err = append_err; }
+
+        if (err) {
+            JF_LOG("failed to fold %zu versions into %s", versions.size() - stored, pack_path.c_str());
+            for (size_t i = stored; i < versions.size(); ++i) { failed.push_back(*versions[i]); }
+            continue;
+        }
+
+        // recovery skips this timeline's versions from here on, written before the slow part below
+        std::string marker;
+        project_log_serialize({ PROJECT_LOG_FOLDED, 0, 0, 0, name, "" }, marker);
+
+        FILE* f = fopen(fold_path.c_str(), "ab");
+        bool marked = f && fwrite(marker.data(), 1, marker.size(), f) == marker.size() && project_log_flush(f);
+        if (f && fclose(f) != 0) { marked = false; }
+
+        if (!marked) {
+            JF_LOG("failed to mark %s as folded, recovery will find its versions in the pack", name.c_str());
+        }
+
+        // parsed here once, off the ui thread, so loading them later is just a mapping
+        if (jf_pack_write_snapshots(pack_path.c_str())) {
+            JF_LOG("failed to snapshot %s, its versions will be parsed on load", pack_path.c_str());
+        }
+
+        if (on_folded) { on_folded(name, pack_path); }
+    }
+}
+
+void ProjectLog::fold_async() {
+    if (!file || fold_pending || committed.empty()) { return; }
+
+    std::error_code ec;
+    std::string log_path  = (fs::path(folder) / PROJECT_LOG_FILE_NAME).string();
+    std::string fold_path = (fs::path(folder) / PROJECT_LOG_FOLD_NAME).string();
+
+    // the committed segment is set aside for the fold, new commits start a fresh one
+    fclose(file);
+    fs::rename(log_path, fold_path, ec);
+    file = fopen(log_path.c_str(), "ab");
+
+    if (ec || !file) {
+        JF_LOG("failed to rotate the project log");
+        return;
+    }
+
+    std::vector<ProjectLogRecord> records = std::move(committed);
+    committed.clear();
+    committed_bytes = 0;
+
+    fold_failed.clear();
+    fold_done = false;
+    fold_pending = true;
+
+    std::string fold_folder = folder;
+    fold_thread = std::thread([this, fold_folder, records = std::move(records)]() {
+        project_log_fold(fold_folder, records, fold_failed, on_folded);
+        fold_done = true;
+    });
+}
+
+void ProjectLog::fold_wait() {
+    if (fold_thread.joinable()) { fold_thread.join(); }
+}
+
+bool ProjectLog::fold_finished() {
+    if (!fold_pending || !fold_done) { return false; }
+
+    fold_wait();
+
+    // versions that didn't make it into their pack go back into the live segment before the old one goes
+    if (!fold_failed.empty()) {
+        staged.insert(staged.begin(), fold_failed.begin(), fold_failed.end());
+        fold_failed.clear();
+        if (!commit()) { return false; }
+    }
+
+    return true;
+}
+
+void ProjectLog::fold_discard() {
+    if (!fold_pending) { return; }
+
+    std::error_code ec;
+    fs::remove(fs::path(folder) / PROJECT_LOG_FOLD_NAME, ec);
+    fold_pending = false;
+}
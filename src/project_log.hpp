@@ -0,0 +1,97 @@
+#ifndef _PROJECT_LOG_HPP
+#define _PROJECT_LOG_HPP
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+    project write ahead log
+
+    captured versions and the metadata that goes with them are staged in memory and
+    written out together by commit(), one write and one fsync per batch. a fold moves
+    committed versions into their timeline packs on a background thread, the log
+    segment is dropped once the project file has been saved after it.
+
+    <project>/project.wal       segment commits go to
+    <project>/project.wal.fold  segment being folded, only exists while (or if) a fold is unfinished
+
+    records are framed with a checksum, recovery reads both segments up to the first
+    torn record. timelines that were completely folded are marked in their segment as
+    soon as their pack is synced, and versions whose id their pack already holds are
+    dropped on recovery and skipped by the next fold, so however a fold fails or a crash
+    falls no version is stored twice.
+*/
+
+#define PROJECT_LOG_FILE_NAME "project.wal"
+#define PROJECT_LOG_FOLD_NAME "project.wal.fold"
+
+enum ProjectLogType {
+    PROJECT_LOG_VERSION = 1, // name = timeline folder, data = raw json
+    PROJECT_LOG_HASH    = 2, // name = source path, hash = raw hash, canonical = canonical hash
+    PROJECT_LOG_TRACK   = 3, // name = source path, data = timeline folder
+    PROJECT_LOG_FOLDED  = 4, // name = timeline folder, every version of it in this segment is in its pack
+};
+
+struct ProjectLogRecord {
+    ProjectLogType type;
+    uint64_t id = 0;
+    uint64_t hash = 0;
+    uint64_t canonical = 0;
+    std::string name = "";
+    std::string data = "";
+};
+
+struct ProjectLog {
+    std::string folder = "";
+
+    // a fold starts once this much is committed, or the log has been quiet for fold_idle
+    size_t fold_bytes = 4 << 20;
+    std::chrono::milliseconds fold_idle = std::chrono::milliseconds(2000);
+
+    // runs on the fold thread once a timeline's new versions are safely in its pack
+    std::function<void(const std::string& name, const std::string& pack_path)> on_folded = nullptr;
+
+    // replays both segments into recovered, versions come back unfolded
+    bool open(const std::string& project_folder, std::vector<ProjectLogRecord>& recovered);
+    void close();
+    bool is_open() const { return file != NULL; }
+
+    void append(ProjectLogRecord record);
+    bool commit();
+
+    bool should_fold() const;
+    bool folding() const { return fold_pending; }
+    void fold_async();
+    void fold_wait();
+
+    // true once a fold is done, the caller saves its metadata and then calls fold_discard
+    bool fold_finished();
+    void fold_discard();
+
+    ProjectLog() = default;
+    ProjectLog(const ProjectLog&) = delete;
+    ProjectLog& operator=(const ProjectLog&) = delete;
+    ~ProjectLog() { close(); }
+
+private:
+    FILE* file = NULL;
+    std::vector<ProjectLogRecord> staged = {};
+    std::vector<ProjectLogRecord> committed = {};
+    size_t committed_bytes = 0;
+    std::chrono::steady_clock::time_point last_commit = {};
+
+    std::thread fold_thread;
+    bool fold_pending = false;
+    std::atomic<bool> fold_done = false;
+    std::vector<ProjectLogRecord> fold_failed = {};
+
+    bool write(const std::vector<ProjectLogRecord>& records);
+};
+
+#endif
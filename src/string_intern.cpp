@@ -0,0 +1,220 @@
+#include "string_intern.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+#include <vector>
+#include <string.h>
+
+// shared by every table, ids never repeat within a process
+static std::atomic<uint64_t> jf_intern_next_id(1);
+
+// a canonical copy, its bytes live in one of the table's blocks
+struct jf_InternEntry {
+    const char* data;
+    uint64_t hash;
+    uint32_t len;
+    uint32_t id;
+};
+
+struct jf_InternHash {
+    size_t operator()(const jf_InternEntry& entry) const { return (size_t) entry.hash; }
+};
+
+struct jf_InternEqual {
+    bool operator()(const jf_InternEntry& a, const jf_InternEntry& b) const {
+        return a.hash == b.hash && a.len == b.len && memcmp(a.data, b.data, a.len) == 0;
+    }
+};
+
+struct jf_ShapeHash {
+    size_t operator()(const jf_Shape* shape) const { return (size_t) shape->hash; }
+};
+
+struct jf_ShapeEqual {
+    bool operator()(const jf_Shape* a, const jf_Shape* b) const { return jf_shape_equal(a, b); }
+};
+
+struct jf_InternTable {
+    std::shared_mutex lock;
+    std::unordered_set<jf_InternEntry, jf_InternHash, jf_InternEqual> entries;
+    std::unordered_set<jf_Shape*, jf_ShapeHash, jf_ShapeEqual> shapes; // refs 0, the table's until it closes
+
+    std::vector<char*> blocks;
+    size_t block_used = JF_INTERN_BLOCK; // of the last block, full until the first one exists
+
+    // '\0' terminated copy of data, only called under the writer lock
+    const char* store(const char* data, size_t len) {
+        if (len + 1 > JF_INTERN_BLOCK) {
+            char* own = (char*) jf_alloc(len + 1);
+            if (!own) { return NULL; }
+
+            // keeps the current block the last one, it still has room
+            blocks.insert(blocks.empty() ? blocks.end() : blocks.end() - 1, own);
+            memcpy(own, data, len);
+            own[len] = 0;
+            return own;
+        }
+
+        if (block_used + len + 1 > JF_INTERN_BLOCK) {
+            char* block = (char*) jf_alloc(JF_INTERN_BLOCK);
+            if (!block) { return NULL; }
+
+            blocks.push_back(block);
+            block_used = 0;
+        }
+
+        char* copy = blocks.back() + block_used;
+        memcpy(copy, data, len);
+        copy[len] = 0;
+        block_used += len + 1;
+
+        return copy;
+    }
+};
+
+jf_Error jf_intern_open(jf_InternTable** table) {
+    if (!table) { return JF_NO_REF; }
+
+    *table = new (std::nothrow) jf_InternTable();
+    return *table ? JF_SUCCESS : JF_NO_MEM;
+}
+
+jf_Error jf_intern_close(jf_InternTable* table) {
+    if (!table) { return JF_NO_REF; }
+
+    for (jf_Shape* shape : table->shapes) {
+        shape->refs = 1;
+        jf_shape_release(shape);
+    }
+
+    for (char* block : table->blocks) { jf_free(block); }
+    delete table;
+
+    return JF_SUCCESS;
+}
+
+// points str at entry, it already holds the same bytes
+static void jf_intern_apply(jf_String* str, const jf_InternEntry* entry) {
+    str->id = entry->id;
+    if (str->len < JF_STRING_SMALL) { return; } // inline either way, the id is all it gains
+
+    if (str->allocated) { jf_free(str->heap); }
+    str->heap = (char*) entry->data;
+    str->allocated = JF_FALSE;
+}
+
+jf_Error jf_intern_string(jf_InternTable* table, jf_String* str) {
+    if (!table || !str) { return JF_NO_REF; }
+    if (str->id)        { return JF_SUCCESS; }
+
+    jf_InternEntry key = { jf_string_data(str), jf_string_hash(str), str->len, 0 };
+
+    {
+        std::shared_lock<std::shared_mutex> read(table->lock);
+
+        auto found = table->entries.find(key);
+        if (found != table->entries.end()) {
+            jf_intern_apply(str, &*found);
+            return JF_SUCCESS;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> write(table->lock);
+
+    // another thread may have added it in between
+    auto found = table->entries.find(key);
+    if (found != table->entries.end()) {
+        jf_intern_apply(str, &*found);
+        return JF_SUCCESS;
+    }
+
+    // out of ids, strings just stay as they are from here on
+    uint64_t id = jf_intern_next_id++;
+    if (id > UINT32_MAX) { return JF_SUCCESS; }
+
+    key.data = table->store(key.data, key.len);
+    key.id = (uint32_t) id;
+    if (!key.data) { return JF_NO_MEM; }
+
+    jf_intern_apply(str, &*table->entries.insert(key).first);
+
+    return JF_SUCCESS;
+}
+
+// moves obj onto the table's shape for its keys, the one it had is released
+static jf_Error jf_intern_shape(jf_InternTable* table, jf_Object* obj) {
+    jf_Error err;
+    jf_Shape* shape = obj->shape;
+
+    if (shape->refs == 0) { return JF_SUCCESS; } // already a table's
+
+    {
+        std::shared_lock<std::shared_mutex> read(table->lock);
+
+        auto found = table->shapes.find(shape);
+        if (found != table->shapes.end()) {
+            obj->shape = *found;
+            return jf_shape_release(shape);
+        }
+    }
+
+    // keys are interned before the writer lock is taken, jf_intern_string takes it itself
+    jf_Shape* canonical = NULL;
+    if (err = jf_shape_alloc(&canonical, shape->keys, shape->count, JF_TRUE)) { return err; }
+
+    for (uint32_t i = 0; i < canonical->count; ++i) {
+        if (err = jf_intern_string(table, &canonical->keys[i])) {
+            jf_shape_release(canonical);
+            return err;
+        }
+    }
+
+    {
+        std::unique_lock<std::shared_mutex> write(table->lock);
+
+        // another thread may have added it in between
+        auto inserted = table->shapes.insert(canonical);
+        if (inserted.second) {
+            canonical->refs = 0;
+        } else {
+            jf_shape_release(canonical);
+            canonical = *inserted.first;
+        }
+    }
+
+    obj->shape = canonical;
+    return jf_shape_release(shape);
+}
+
+jf_Error jf_intern_node(jf_InternTable* table, jf_Node* node) {
+    if (!table || !node) { return JF_NO_REF; }
+
+    jf_Error err;
+
+    switch (node->type) {
+        case JF_STRING: {
+            if (node->s_value->len <= JF_INTERN_VALUE_MAX) { return jf_intern_string(table, node->s_value); }
+        } break;
+
+        case JF_ARRAY: {
+            for (size_t i = 0; i < node->a_value->used; ++i) {
+                if (err = jf_intern_node(table, node->a_value->elements[i])) { return err; }
+            }
+        } break;
+
+        case JF_OBJECT: {
+            jf_Object* obj = node->o_value;
+            if (err = jf_intern_shape(table, obj)) { return err; }
+
+            for (size_t i = 0; i < obj->used; ++i) {
+                if (err = jf_intern_node(table, obj->values[i])) { return err; }
+            }
+        } break;
+
+        default: break;
+    }
+
+    return JF_SUCCESS;
+}
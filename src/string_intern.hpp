@@ -0,0 +1,38 @@
+#ifndef _STRING_INTERN_HPP
+#define _STRING_INTERN_HPP
+
+#include "jf.h"
+
+/*
+    string intern - one canonical copy of the keys and short values a project's versions share
+
+    every version of a config repeats the same keys. interning a string points it at the
+    table's copy of its bytes and gives it the copy's 32 bit id, so long strings stop being
+    stored once per object per version and interned strings match on an integer compare.
+    ids are handed out process wide, equal ids mean equal bytes even across tables.
+
+    object shapes are interned the same way, every object with the same keys in the same
+    order ends up on one shape across all of the project's versions.
+
+    lookups share a reader lock, only strings the table hasn't seen yet take the writer lock,
+    so versions can be interned from jf_parallel_for workers. the table owns the bytes and
+    shapes and has to outlive every tree interned into it. an object's old shape is released
+    when it moves, so a tree is interned before anything keeps pointers to its keys (diffs).
+*/
+
+#define JF_INTERN_VALUE_MAX 64      // string values up to this long are interned, keys always are
+#define JF_INTERN_BLOCK     0x10000 // canonical bytes are packed into blocks of this size
+
+struct jf_InternTable;
+
+jf_Error jf_intern_open(jf_InternTable** table);
+
+jf_Error jf_intern_close(jf_InternTable* table);
+
+// str ends up pointing at the table's copy, whatever it owned is released
+jf_Error jf_intern_string(jf_InternTable* table, jf_String* str);
+
+// every object's shape and every string value up to JF_INTERN_VALUE_MAX bytes
+jf_Error jf_intern_node(jf_InternTable* table, jf_Node* node);
+
+#endif
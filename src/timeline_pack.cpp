@@ -0,0 +1,1023 @@
+#include "timeline_pack.hpp"
+#include "node_snapshot.hpp"
+#include "json_parse.hpp"
+#include "string.h"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <vector>
+namespace fs = std::filesystem;
+
+#if defined(_WIN32)
+#   include <io.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/stat.h>
+#endif
+
+static size_t jf_pack_record_span(uint64_t size) {
+    size_t span = sizeof(jf_PackRecordHeader) + (size_t) size;
+    return (span + (JF_PACK_ALIGN - 1)) & ~(size_t) (JF_PACK_ALIGN - 1);
+}
+
+static int jf_pack_seek(FILE* f, size_t offset) {
+#if defined(_WIN32)
+    return _fseeki64(f, (long long) offset, SEEK_SET);
+#else
+    return fseeko(f, (off_t) offset, SEEK_SET);
+#endif
+}
+
+/*
+    read side
+*/
+
+// uses the trailer index in place if it is intact
+static jf_Bool jf_pack_read_trailer(jf_Pack* pack) {
+    const jf_FileMap* map = &pack->map;
+    if (map->size < sizeof(jf_PackHeader) + sizeof(jf_PackTrailer)) { return JF_FALSE; }
+
+    jf_PackTrailer trailer;
+    memcpy(&trailer, map->data + map->size - sizeof(jf_PackTrailer), sizeof(jf_PackTrailer));
+
+    if (trailer.magic != JF_PACK_INDEX_MAGIC)                   { return JF_FALSE; }
+    if (trailer.entry_size != sizeof(jf_PackIndexEntry))        { return JF_FALSE; }
+    if (trailer.index_offset < sizeof(jf_PackHeader))           { return JF_FALSE; }
+    if (trailer.index_offset % JF_PACK_ALIGN != 0)              { return JF_FALSE; }
+    if (trailer.count > map->size / sizeof(jf_PackIndexEntry))  { return JF_FALSE; }
+
+    uint64_t index_end = trailer.index_offset + trailer.count * sizeof(jf_PackIndexEntry);
+    if (index_end + sizeof(jf_PackTrailer) != map->size) { return JF_FALSE; }
+
+    pack->count       = (size_t) trailer.count;
+    pack->data_end    = (size_t) trailer.index_offset;
+    pack->index       = (const jf_PackIndexEntry*) (map->data + trailer.index_offset);
+    pack->index_owned = JF_FALSE;
+
+    return JF_TRUE;
+}
+
+// rebuilds the index from the records, stops at the first torn or foreign frame
+static jf_Error jf_pack_recover(jf_Pack* pack) {
+    const jf_FileMap* map = &pack->map;
+
+    size_t count = 0;
+    size_t capacity = 0;
+    jf_PackIndexEntry* index = NULL;
+    size_t offset = sizeof(jf_PackHeader);
+
+    while (offset + sizeof(jf_PackRecordHeader) <= map->size) {
+        jf_PackRecordHeader header;
+        memcpy(&header, map->data + offset, sizeof(jf_PackRecordHeader));
+
+        if (header.magic != JF_PACK_RECORD_MAGIC) { break; }
+        if (header.size > map->size - offset - sizeof(jf_PackRecordHeader)) { break; }
+
+        size_t span = jf_pack_record_span(header.size);
+        if (span > map->size - offset) { break; }
+
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            jf_PackIndexEntry* grown = (jf_PackIndexEntry*) jf_alloc(capacity * sizeof(jf_PackIndexEntry));
+            if (!grown) {
+                if (index) { jf_free(index); }
+                return JF_NO_MEM;
+            }
+
+            if (index) {
+                memcpy(grown, index, count * sizeof(jf_PackIndexEntry));
+                jf_free(index);
+            }
+            index = grown;
+        }
+
+        index[count].offset = offset;
+        index[count].id = header.id;
+        index[count].hash = jf_hash_bytes(map->data + offset + sizeof(jf_PackRecordHeader), (size_t) header.size);
+
+        // references share the hash of what they point at, which was scanned already
+        if (header.encoding == JF_PACK_REF) {
+            uint64_t target = 0;
+            if (header.size == sizeof(target)) {
+                memcpy(&target, map->data + offset + sizeof(jf_PackRecordHeader), sizeof(target));
+            }
+
+            const jf_PackIndexEntry* found = std::lower_bound(index, index + count, target, [](const jf_PackIndexEntry& e, uint64_t o) {
+                return e.offset < o;
+            });
+            if (found == index + count || found->offset != target) { break; }
+
+            index[count].hash = found->hash;
+        }
+
+        ++count;
+
+        offset += span;
+    }
+
+    JF_DEBUG_LOG("pack recovered %zu records", count);
+
+    pack->count       = count;
+    pack->data_end    = offset;
+    pack->index       = index;
+    pack->index_owned = JF_TRUE;
+
+    return JF_SUCCESS;
+}
+
+// versions are read back in id order, packs written by the writer already are so this is one pass
+static jf_Error jf_pack_order_index(jf_Pack* pack) {
+    jf_Bool ordered = JF_TRUE;
+    for (size_t i = 1; i < pack->count && ordered; ++i) {
+        if (pack->index[i].id < pack->index[i - 1].id) { ordered = JF_FALSE; }
+    }
+
+    if (ordered) { return JF_SUCCESS; }
+
+    jf_PackIndexEntry* index = (jf_PackIndexEntry*) pack->index;
+    if (!pack->index_owned) {
+        index = (jf_PackIndexEntry*) jf_alloc(pack->count * sizeof(jf_PackIndexEntry));
+        if (!index) { return JF_NO_MEM; }
+
+        memcpy(index, pack->index, pack->count * sizeof(jf_PackIndexEntry));
+        pack->index = index;
+        pack->index_owned = JF_TRUE;
+    }
+
+    // equal ids come from second resolution timestamps, keep those in the order they were written
+    std::stable_sort(index, index + pack->count, [](const jf_PackIndexEntry& a, const jf_PackIndexEntry& b) {
+        return a.id < b.id;
+    });
+
+    JF_DEBUG_LOG("pack index reordered by id");
+    return JF_SUCCESS;
+}
+
+jf_Error jf_pack_open(jf_Pack** pack, const char* path) {
+    if (!pack || !path) { return JF_NO_REF; }
+
+    jf_Error err;
+
+    jf_Pack* p = (jf_Pack*) jf_calloc(1, sizeof(jf_Pack));
+    if (!p) { return JF_NO_MEM; }
+
+    if (err = jf_file_map_open(&p->map, path)) {
+        jf_free(p);
+        return err;
+    }
+
+    jf_PackHeader header = { 0, 0 };
+    if (p->map.size >= sizeof(jf_PackHeader)) {
+        memcpy(&header, p->map.data, sizeof(jf_PackHeader));
+    }
+
+    if (header.magic != JF_PACK_MAGIC || header.version == 0 || header.version > JF_PACK_FORMAT_VERSION) {
+        jf_file_map_close(&p->map);
+        jf_free(p);
+        return JF_INVALID_SYNTAX;
+    }
+
+    if (!jf_pack_read_trailer(p)) {
+        if (err = jf_pack_recover(p)) {
+            jf_file_map_close(&p->map);
+            jf_free(p);
+            return err;
+        }
+    }
+
+    if (err = jf_pack_order_index(p)) {
+        jf_pack_close(p);
+        return err;
+    }
+
+    *pack = p;
+    return JF_SUCCESS;
+}
+
+jf_Error jf_pack_close(jf_Pack* pack) {
+    if (!pack) { return JF_NO_REF; }
+
+    if (pack->index_owned && pack->index) {
+        jf_free((void*) pack->index);
+    }
+
+    jf_file_map_close(&pack->map);
+    jf_free(pack);
+
+    return JF_SUCCESS;
+}
+
+static jf_Error jf_pack_read_header(const jf_Pack* pack, size_t offset, jf_PackRecordHeader* header) {
+    if (offset + sizeof(jf_PackRecordHeader) > pack->data_end) { return JF_INDEX_OUT_OF_BOUNDS; }
+
+    memcpy(header, pack->map.data + offset, sizeof(jf_PackRecordHeader));
+
+    if (header->magic != JF_PACK_RECORD_MAGIC) { return JF_INVALID_SYNTAX; }
+    if (header->size > pack->data_end - offset - sizeof(jf_PackRecordHeader)) { return JF_INDEX_OUT_OF_BOUNDS; }
+
+    return JF_SUCCESS;
+}
+
+jf_Error jf_pack_get(const jf_Pack* pack, size_t index, jf_PackRecord* record) {
+    if (!pack || !record) { return JF_NO_REF; }
+    if (index >= pack->count) { return JF_INDEX_OUT_OF_BOUNDS; }
+
+    jf_Error err;
+    jf_PackRecordHeader header;
+
+    size_t offset = (size_t) pack->index[index].offset;
+    if (err = jf_pack_read_header(pack, offset, &header)) { return err; }
+
+    record->id = header.id;
+
+    // references only ever point back at a record that holds the payload itself
+    if (header.encoding == JF_PACK_REF) {
+        uint64_t target;
+        if (header.size != sizeof(target)) { return JF_INVALID_SYNTAX; }
+
+        memcpy(&target, pack->map.data + offset + sizeof(jf_PackRecordHeader), sizeof(target));
+        if (target >= offset) { return JF_INVALID_SYNTAX; }
+
+        offset = (size_t) target;
+        if (err = jf_pack_read_header(pack, offset, &header)) { return err; }
+        if (header.encoding == JF_PACK_REF)                  { return JF_INVALID_SYNTAX; }
+    }
+
+    record->encoding = (jf_PackEncoding) header.encoding;
+    record->data     = pack->map.data + offset + sizeof(jf_PackRecordHeader);
+    record->size     = (size_t) header.size;
+
+    return JF_SUCCESS;
+}
+
+jf_Error jf_pack_find(const jf_Pack* pack, uint64_t id, size_t* index) {
+    if (!pack || !index) { return JF_NO_REF; }
+
+    const jf_PackIndexEntry* end = pack->index + pack->count;
+    const jf_PackIndexEntry* entry = std::lower_bound(pack->index, end, id, [](const jf_PackIndexEntry& e, uint64_t value) {
+        return e.id < value;
+    });
+
+    if (entry == end || entry->id != id) { return JF_INDEX_OUT_OF_BOUNDS; }
+
+    *index = (size_t) (entry - pack->index);
+    return JF_SUCCESS;
+}
+
+// snapshot packs sit next to the pack they belong to
+static std::string jf_pack_snapshot_path(const char* path) {
+    return (fs::path(path).parent_path() / JF_PACK_SNAPSHOT_NAME).string();
+}
+
+static jf_Error jf_pack_close_backing(void* pack) {
+    return jf_pack_close((jf_Pack*) pack);
+}
+
+jf_Error jf_pack_load_node(const jf_Pack* pack, const jf_Pack* snapshots, size_t index, jf_Node** node, jf_Bool borrow) {
+    if (!pack || !node) { return JF_NO_REF; }
+    if (index >= pack->count) { return JF_INDEX_OUT_OF_BOUNDS; }
+
+    size_t at;
+    jf_PackRecord record;
+    jf_Snapshot snapshot;
+
+    // a missing or damaged snapshot only costs the parse it was there to save
+    if (snapshots
+        && jf_pack_find(snapshots, pack->index[index].id, &at) == JF_SUCCESS
+        && jf_pack_get(snapshots, at, &record) == JF_SUCCESS
+        && record.encoding == JF_PACK_NODE
+        && jf_snapshot_open(&snapshot, record.data, record.size) == JF_SUCCESS
+        && jf_snapshot_thaw(&snapshot, node, borrow) == JF_SUCCESS) {
+        return JF_SUCCESS;
+    }
+
+    jf_Error err;
+    if (err = jf_pack_get(pack, index, &record)) { return err; }
+
+    return jf_parse_from_json_buffer(node, record.data, record.size);
+}
+
+/*
+    write side
+*/
+
+static jf_Error jf_pack_writer_reserve(jf_PackWriter* writer, size_t count) {
+    if (count <= writer->capacity) { return JF_SUCCESS; }
+
+    size_t capacity = JF_MATH_MAX(count, writer->capacity * 2);
+    jf_PackIndexEntry* grown = (jf_PackIndexEntry*) jf_alloc(capacity * sizeof(jf_PackIndexEntry));
+    if (!grown) { return JF_NO_MEM; }
+
+    if (writer->index) {
+        memcpy(grown, writer->index, writer->count * sizeof(jf_PackIndexEntry));
+        jf_free(writer->index);
+    }
+
+    writer->index = grown;
+    writer->capacity = capacity;
+
+    return JF_SUCCESS;
+}
+
+jf_Error jf_pack_writer_open(jf_PackWriter** writer, const char* path) {
+    if (!writer || !path) { return JF_NO_REF; }
+
+    jf_Error err;
+    std::error_code ec;
+
+    jf_PackWriter* w = (jf_PackWriter*) jf_calloc(1, sizeof(jf_PackWriter));
+    if (!w) { return JF_NO_MEM; }
+
+    // fresh pack
+    if (!fs::exists(path, ec) || fs::file_size(path, ec) == 0) {
+        w->file = fopen(path, "w+b");
+        if (!w->file) {
+            jf_free(w);
+            return JF_INVALID_FILE_PATH;
+        }
+
+        jf_PackHeader header = { JF_PACK_MAGIC, JF_PACK_FORMAT_VERSION };
+        if (fwrite(&header, sizeof(header), 1, w->file) != 1) {
+            fclose(w->file);
+            jf_free(w);
+            return JF_IO_ERROR;
+        }
+
+        w->data_end = sizeof(header);
+        *writer = w;
+        return JF_SUCCESS;
+    }
+
+    // existing pack, keep its index in memory and cut the old index + any torn tail off the file
+    jf_Pack* pack = NULL;
+    if (err = jf_pack_open(&pack, path)) {
+        jf_free(w);
+        return err;
+    }
+
+    if (err = jf_pack_writer_reserve(w, pack->count + 1)) {
+        jf_pack_close(pack);
+        jf_free(w);
+        return err;
+    }
+
+    memcpy(w->index, pack->index, pack->count * sizeof(jf_PackIndexEntry));
+    w->count = pack->count;
+    w->data_end = pack->data_end;
+    jf_pack_close(pack);
+
+    fs::resize_file(path, w->data_end, ec);
+    if (ec) {
+        jf_free(w->index);
+        jf_free(w);
+        return JF_IO_ERROR;
+    }
+
+    // older packs are a subset of the current format, only the version needs to move
+    jf_PackHeader header = { JF_PACK_MAGIC, JF_PACK_FORMAT_VERSION };
+
+    w->file = fopen(path, "r+b");
+    if (!w->file || fwrite(&header, sizeof(header), 1, w->file) != 1 || jf_pack_seek(w->file, w->data_end) != 0) {
+        if (w->file) { fclose(w->file); }
+        jf_free(w->index);
+        jf_free(w);
+        return JF_INVALID_FILE_PATH;
+    }
+
+    *writer = w;
+    return JF_SUCCESS;
+}
+
+uint64_t jf_pack_next_id() {
+    static std::atomic<uint64_t> last(0);
+
+    uint64_t now = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+
+    uint64_t prev = last.load();
+    uint64_t id;
+    do {
+        id = now > prev ? now : prev + 1;
+    } while (!last.compare_exchange_weak(prev, id));
+
+    return id;
+}
+
+// ids within a pack only go up, even if the clock stepped back since the last append
+static uint64_t jf_pack_writer_next_id(const jf_PackWriter* writer, uint64_t id) {
+    if (writer->count == 0) { return id; }
+
+    uint64_t last = writer->index[writer->count - 1].id;
+    return id > last ? id : last + 1;
+}
+
+// drops whatever a failed append left past data_end, the next record or the index goes there instead
+static jf_Error jf_pack_writer_rewind(jf_PackWriter* writer, jf_Error err) {
+    fflush(writer->file);
+
+#if defined(_WIN32)
+    _chsize_s(_fileno(writer->file), (long long) writer->data_end);
+#elif defined(__unix__) || defined(__APPLE__)
+    if (ftruncate(fileno(writer->file), (off_t) writer->data_end) != 0) {
+        JF_LOG("failed to trim a partial record at %zu", writer->data_end);
+    }
+#endif
+
+    jf_pack_seek(writer->file, writer->data_end);
+    return err;
+}
+
+static jf_Error jf_pack_writer_record(jf_PackWriter* writer, uint64_t id, jf_PackEncoding encoding, const char* data, size_t size, uint64_t hash) {
+    jf_PackRecordHeader header = { JF_PACK_RECORD_MAGIC, (uint32_t) encoding, id, size };
+    size_t span = jf_pack_record_span(size);
+    size_t padding = span - sizeof(header) - size;
+    static const char zeros[JF_PACK_ALIGN] = { 0 };
+
+    if (fwrite(&header, sizeof(header), 1, writer->file) != 1)            { return jf_pack_writer_rewind(writer, JF_IO_ERROR); }
+    if (size && fwrite(data, 1, size, writer->file) != size)              { return jf_pack_writer_rewind(writer, JF_IO_ERROR); }
+    if (padding && fwrite(zeros, 1, padding, writer->file) != padding)    { return jf_pack_writer_rewind(writer, JF_IO_ERROR); }
+
+    writer->index[writer->count].offset = writer->data_end;
+    writer->index[writer->count].id = id;
+    writer->index[writer->count].hash = hash;
+    writer->count++;
+    writer->data_end += span;
+
+    return JF_SUCCESS;
+}
+
+// offset of the record holding exactly data, or 0 if the pack doesn't have it yet
+static uint64_t jf_pack_writer_find(jf_PackWriter* writer, jf_PackEncoding encoding, const char* data, size_t size, uint64_t hash) {
+    uint64_t found = 0;
+
+    for (size_t i = writer->count; i-- > 0 && !found; ) {
+        if (writer->index[i].hash != hash) { continue; }
+
+        // a hash match still gets its bytes compared, the payload is read back from the file
+        jf_PackRecordHeader header;
+        uint64_t offset = writer->index[i].offset;
+
+        if (fflush(writer->file) != 0 || jf_pack_seek(writer->file, (size_t) offset) != 0) { break; }
+        if (fread(&header, sizeof(header), 1, writer->file) != 1)                          { break; }
+
+        if (header.encoding == JF_PACK_REF) {
+            if (fread(&offset, sizeof(offset), 1, writer->file) != 1)                                    { break; }
+            if (jf_pack_seek(writer->file, (size_t) offset) != 0)                                        { break; }
+            if (fread(&header, sizeof(header), 1, writer->file) != 1 || header.encoding == JF_PACK_REF)  { break; }
+        }
+
+        if (header.magic != JF_PACK_RECORD_MAGIC || header.encoding != (uint32_t) encoding || header.size != size) { continue; }
+
+        char buffer[4096];
+        size_t compared = 0;
+        while (compared < size) {
+            size_t chunk = JF_MATH_MIN(sizeof(buffer), size - compared);
+            if (fread(buffer, 1, chunk, writer->file) != chunk || memcmp(buffer, data + compared, chunk) != 0) { break; }
+            compared += chunk;
+        }
+
+        if (compared == size) { found = offset; }
+    }
+
+    // back to where the next record goes, reads and writes on one FILE need a seek in between
+    jf_pack_seek(writer->file, writer->data_end);
+    return found;
+}
+
+jf_Error jf_pack_writer_append(jf_PackWriter* writer, uint64_t id, jf_PackEncoding encoding, const char* data, size_t size) {
+    if (!writer || !writer->file || (!data && size)) { return JF_NO_REF; }
+
+    jf_Error err;
+    if (err = jf_pack_writer_reserve(writer, writer->count + 1)) { return err; }
+
+    id = jf_pack_writer_next_id(writer, id);
+    uint64_t hash = jf_hash_bytes(data, size);
+
+    // a reference only pays off when it is smaller than the payload
+    if (size > sizeof(uint64_t) && encoding != JF_PACK_REF) {
+        uint64_t target = jf_pack_writer_find(writer, encoding, data, size, hash);
+        if (target) {
+            return jf_pack_writer_record(writer, id, JF_PACK_REF, (const char*) &target, sizeof(target), hash);
+        }
+    }
+
+    return jf_pack_writer_record(writer, id, encoding, data, size, hash);
+}
+
+// copies size bytes of src_path to offset of the writer's file without a round trip through user space
+static jf_Bool jf_pack_copy_range(jf_PackWriter* writer, const char* src_path, size_t offset, size_t size) {
+#if defined(__linux__)
+    int src = open(src_path, O_RDONLY | O_CLOEXEC);
+    if (src < 0) { return JF_FALSE; }
+
+    struct stat st;
+    if (fstat(src, &st) != 0 || (size_t) st.st_size != size || fflush(writer->file) != 0) {
+        close(src);
+        return JF_FALSE;
+    }
+
+    loff_t in_offset = 0;
+    loff_t out_offset = (loff_t) offset;
+    int dst = fileno(writer->file);
+
+    while ((size_t) in_offset < size) {
+        ssize_t copied = copy_file_range(src, &in_offset, dst, &out_offset, size - (size_t) in_offset, 0);
+        if (copied <= 0) { break; } // not supported here, or the file shrank underneath us
+    }
+
+    close(src);
+    if ((size_t) in_offset == size) { return JF_TRUE; }
+
+    // the trailer has to end up at the very end of the file, drop whatever did get copied
+    if (ftruncate(dst, (off_t) offset) != 0) {
+        JF_LOG("failed to trim a partial copy from %s", src_path);
+    }
+
+    return JF_FALSE;
+#else
+    return JF_FALSE;
+#endif
+}
+
+jf_Error jf_pack_writer_append_file(jf_PackWriter* writer, uint64_t id, jf_PackEncoding encoding, const char* src_path) {
+    if (!writer || !writer->file || !src_path) { return JF_NO_REF; }
+
+    std::error_code ec;
+    size_t size = (size_t) fs::file_size(src_path, ec);
+    if (ec) { return JF_INVALID_FILE_PATH; }
+
+    jf_Error err;
+    if (err = jf_pack_writer_reserve(writer, writer->count + 1)) { return err; }
+
+    id = jf_pack_writer_next_id(writer, id);
+    jf_PackRecordHeader header = { JF_PACK_RECORD_MAGIC, (uint32_t) encoding, id, size };
+    size_t span = jf_pack_record_span(size);
+    size_t padding = span - sizeof(header) - size;
+    static const char zeros[JF_PACK_ALIGN] = { 0 };
+
+    if (fwrite(&header, sizeof(header), 1, writer->file) != 1) { return jf_pack_writer_rewind(writer, JF_IO_ERROR); }
+
+    uint64_t hash = 0;
+    if (size && jf_hash_file(src_path, &hash) == JF_SUCCESS && jf_pack_copy_range(writer, src_path, writer->data_end + sizeof(header), size)) {
+        if (jf_pack_seek(writer->file, writer->data_end + sizeof(header) + size) != 0)  { return jf_pack_writer_rewind(writer, JF_IO_ERROR); }
+        if (padding && fwrite(zeros, 1, padding, writer->file) != padding)             { return jf_pack_writer_rewind(writer, JF_IO_ERROR); }
+
+        writer->index[writer->count].offset = writer->data_end;
+        writer->index[writer->count].id = id;
+        writer->index[writer->count].hash = hash;
+        writer->count++;
+        writer->data_end += span;
+
+        return JF_SUCCESS;
+    }
+
+    // buffered fallback, rewrites the record from the start in case the size moved
+    jf_FileMap map;
+    if (err = jf_file_read(&map, src_path)) { return jf_pack_writer_rewind(writer, err); }
+
+    if (jf_pack_seek(writer->file, writer->data_end) != 0) {
+        jf_file_map_close(&map);
+        return jf_pack_writer_rewind(writer, JF_IO_ERROR);
+    }
+
+    err = jf_pack_writer_append(writer, id, encoding, map.data, map.size);
+    jf_file_map_close(&map);
+
+    return err;
+}
+
+jf_Error jf_pack_writer_find_id(const jf_PackWriter* writer, uint64_t id, size_t* index) {
+    if (!writer || !index) { return JF_NO_REF; }
+
+    // ids only go up within a pack, the index is in id order like a jf_Pack's
+    const jf_PackIndexEntry* end = writer->index + writer->count;
+    const jf_PackIndexEntry* entry = std::lower_bound((const jf_PackIndexEntry*) writer->index, end, id, [](const jf_PackIndexEntry& e, uint64_t value) {
+        return e.id < value;
+    });
+
+    if (entry == end || entry->id != id) { return JF_INDEX_OUT_OF_BOUNDS; }
+
+    *index = (size_t) (entry - writer->index);
+    return JF_SUCCESS;
+}
+
+jf_Error jf_pack_writer_close(jf_PackWriter* writer) {
+    if (!writer) { return JF_NO_REF; }
+
+    jf_Error err = JF_SUCCESS;
+
+    jf_PackTrailer trailer;
+    trailer.index_offset = writer->data_end;
+    trailer.count        = writer->count;
+    trailer.magic        = JF_PACK_INDEX_MAGIC;
+    trailer.entry_size   = sizeof(jf_PackIndexEntry);
+
+    // the index goes right after the last record, wherever a failed append left the file
+    if (jf_pack_seek(writer->file, writer->data_end) != 0) {
+        err = JF_IO_ERROR;
+    } else if (writer->count && fwrite(writer->index, sizeof(jf_PackIndexEntry), writer->count, writer->file) != writer->count) {
+        err = JF_IO_ERROR;
+    } else if (fwrite(&trailer, sizeof(trailer), 1, writer->file) != 1) {
+        err = JF_IO_ERROR;
+    }
+
+    if (fclose(writer->file) != 0) { err = JF_IO_ERROR; }
+
+    if (writer->index) { jf_free(writer->index); }
+    jf_free(writer);
+
+    return err;
+}
+
+jf_Error jf_pack_append(const char* path, uint64_t id, jf_PackEncoding encoding, const char* data, size_t size, uint64_t* stored_id) {
+    jf_Error err;
+    jf_PackWriter* writer = NULL;
+
+    if (err = jf_pack_writer_open(&writer, path)) { return err; }
+
+    err = jf_pack_writer_append(writer, id, encoding, data, size);
+    if (!err && stored_id) { *stored_id = writer->index[writer->count - 1].id; }
+    jf_Error close_err = jf_pack_writer_close(writer);
+
+    return err ? err : close_err;
+}
+
+// appends a reference to the payload at offset. id is moved up like any other append's,
+// unless it has to stay what it is, the way a snapshot keeps the id of its version
+static jf_Error jf_pack_append_ref(const char* path, uint64_t* id, jf_Bool exact, uint64_t offset, uint64_t hash) {
+    jf_Error err;
+    jf_PackWriter* writer = NULL;
+
+    if (err = jf_pack_writer_open(&writer, path)) { return err; }
+
+    uint64_t next = jf_pack_writer_next_id(writer, *id);
+
+    if (exact && next != *id) {
+        err = JF_INDEX_OUT_OF_BOUNDS;
+    } else if (!(err = jf_pack_writer_reserve(writer, writer->count + 1))) {
+        err = jf_pack_writer_record(writer, next, JF_PACK_REF, (const char*) &offset, sizeof(offset), hash);
+        *id = next;
+    }
+
+    jf_Error close_err = jf_pack_writer_close(writer);
+    return err ? err : close_err;
+}
+
+jf_Error jf_pack_restore(const char* path, size_t index, const char* dest_path, uint64_t* stored_id) {
+    if (!path || !dest_path) { return JF_NO_REF; }
+
+    jf_Error err;
+    jf_Pack* pack = NULL;
+    jf_Pack* snapshots = NULL;
+    std::string snapshot_path = jf_pack_snapshot_path(path);
+
+    if (err = jf_pack_open(&pack, path)) { return err; }
+
+    jf_PackRecord record;
+    if (!(err = jf_pack_get(pack, index, &record)) && record.encoding != JF_PACK_JSON) { err = JF_INVALID_TYPE; }
+
+    if (err) {
+        jf_pack_close(pack);
+        return err;
+    }
+
+    // references always point at the payload itself, never at another reference
+    uint64_t offset = (uint64_t) (record.data - pack->map.data) - sizeof(jf_PackRecordHeader);
+    uint64_t hash = pack->index[index].hash;
+
+    uint64_t snapshot_offset = 0;
+    uint64_t snapshot_hash = 0;
+    jf_PackRecord snapshot;
+    size_t at;
+
+    if (jf_pack_open(&snapshots, snapshot_path.c_str()) == JF_SUCCESS) {
+        if (jf_pack_find(snapshots, record.id, &at) == JF_SUCCESS && jf_pack_get(snapshots, at, &snapshot) == JF_SUCCESS) {
+            snapshot_offset = (uint64_t) (snapshot.data - snapshots->map.data) - sizeof(jf_PackRecordHeader);
+            snapshot_hash = snapshots->index[at].hash;
+        }
+
+        jf_pack_close(snapshots);
+    }
+
+    // straight from the mapping, the file is written before anything claims it was restored
+    err = jf_file_replace(dest_path, record.data, record.size);
+    jf_pack_close(pack);
+    if (err) { return err; }
+
+    uint64_t id = jf_pack_next_id();
+    if (err = jf_pack_append_ref(path, &id, JF_FALSE, offset, hash)) { return err; }
+    if (err = jf_file_sync(path))                                    { return err; }
+
+    if (stored_id) { *stored_id = id; }
+
+    // a version that never got a snapshot is parsed for one, same as after a fold
+    if (!snapshot_offset || jf_pack_append_ref(snapshot_path.c_str(), &id, JF_TRUE, snapshot_offset, snapshot_hash)) {
+        if (jf_pack_write_snapshots(path)) {
+            JF_LOG("failed to snapshot %s, its versions will be parsed on load", path);
+        }
+    }
+
+    return JF_SUCCESS;
+}
+
+/*
+    legacy folders & timelines
+*/
+
+jf_Error jf_pack_write_snapshots(const char* path) {
+    if (!path) { return JF_NO_REF; }
+
+    jf_Error err;
+    jf_Pack* pack = NULL;
+    jf_Pack* snapshots = NULL;
+    std::string snapshot_path = jf_pack_snapshot_path(path);
+
+    if (err = jf_pack_open(&pack, path)) { return err; }
+
+    // the snapshots are only a cache, one that can't be read is started over
+    if (jf_pack_open(&snapshots, snapshot_path.c_str()) != JF_SUCCESS) {
+        std::error_code ec;
+        fs::remove(snapshot_path, ec);
+    }
+
+    std::vector<size_t> missing;
+    for (size_t i = 0; i < pack->count; ++i) {
+        size_t at;
+        if (!snapshots || jf_pack_find(snapshots, pack->index[i].id, &at) != JF_SUCCESS) { missing.push_back(i); }
+    }
+
+    if (snapshots) { jf_pack_close(snapshots); }
+    if (missing.empty()) { return jf_pack_close(pack); }
+
+    jf_PackWriter* writer = NULL;
+    if (err = jf_pack_writer_open(&writer, snapshot_path.c_str())) {
+        jf_pack_close(pack);
+        return err;
+    }
+
+    size_t written = 0;
+    for (size_t i : missing) {
+        uint64_t id = pack->index[i].id;
+
+        // the writer would move an older id up, those versions just keep being parsed
+        if (writer->count && id <= writer->index[writer->count - 1].id) { continue; }
+
+        jf_PackRecord record;
+        jf_Node* node = NULL;
+        if (jf_pack_get(pack, i, &record) || jf_parse_from_json_buffer(&node, record.data, record.size)) { continue; }
+
+        char* data = NULL;
+        size_t size = 0;
+        err = jf_snapshot_encode(node, &data, &size);
+        jf_node_free(node);
+
+        if (!err) {
+            err = jf_pack_writer_append(writer, id, JF_PACK_NODE, data, size);
+            jf_free(data);
+        }
+
+        if (err) { break; }
+        written++;
+    }
+
+    jf_Error close_err = jf_pack_writer_close(writer);
+    jf_pack_close(pack);
+
+    if (written) { JF_DEBUG_LOG("wrote %zu snapshots to %s", written, snapshot_path.c_str()); }
+    return err ? err : close_err;
+}
+
+jf_Error jf_pack_import_legacy(const char* folder) {
+    if (!folder) { return JF_NO_REF; }
+
+    std::error_code ec;
+    std::vector<std::pair<uint64_t, fs::path>> legacy;
+
+    for (const auto& entry : fs::directory_iterator(folder, ec)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".json") { continue; }
+
+        std::string stem = entry.path().stem().string();
+        uint64_t id = strtoull(stem.c_str(), NULL, 10);
+        legacy.push_back({ id, entry.path() });
+    }
+
+    if (ec) { return JF_INVALID_FILE_PATH; }
+    if (legacy.empty()) { return JF_SUCCESS; }
+
+    std::sort(legacy.begin(), legacy.end());
+
+    jf_Error err;
+    jf_PackWriter* writer = NULL;
+    std::string pack_path = (fs::path(folder) / JF_PACK_FILE_NAME).string();
+
+    if (err = jf_pack_writer_open(&writer, pack_path.c_str())) { return err; }
+
+    for (const auto& [id, path] : legacy) {
+        jf_FileMap map;
+        if (err = jf_file_map_open(&map, path.string().c_str())) { break; }
+
+        err = jf_pack_writer_append(writer, id, JF_PACK_JSON, map.data, map.size);
+        jf_file_map_close(&map);
+        if (err) { break; }
+    }
+
+    jf_Error close_err = jf_pack_writer_close(writer);
+    if (err)       { return err; }
+    if (close_err) { return close_err; }
+
+    // only drop the loose files once the pack holds them
+    for (const auto& [id, path] : legacy) {
+        fs::remove(path, ec);
+    }
+
+    JF_LOG("packed %zu legacy versions into %s", legacy.size(), pack_path.c_str());
+
+    if (jf_pack_write_snapshots(pack_path.c_str())) {
+        JF_LOG("failed to snapshot %s, its versions will be parsed on load", pack_path.c_str());
+    }
+
+    return JF_SUCCESS;
+}
+
+// diff i is version i - 1 against version i, diff 0 is against the base, or against nothing without one
+static void jf_pack_diff_sides(const jf_TimelineContext* context, size_t i, jf_Node** a, jf_Node** b) {
+    if (i == 0 && !context->base) {
+        *a = context->nodes[0];
+        *b = NULL;
+        return;
+    }
+
+    *a = i == 0 ? context->base : context->nodes[i - 1];
+    *b = context->nodes[i];
+}
+
+// hashes[0] belongs to the base, hashes[i + 1] to nodes[i]
+static jf_DiffKey jf_pack_diff_key(const jf_TimelineContext* context, const std::vector<uint64_t>& hashes, size_t i) {
+    if (i == 0 && !context->base) { return { hashes[1], 0, 0 }; }
+    return { hashes[i], hashes[i + 1], 0 };
+}
+
+size_t jf_pack_window_size(const jf_Pack* pack, size_t budget) {
+    if (!pack || pack->count == 0) { return 0; }
+
+    // references make a pack smaller than what it holds, so sizes are sampled after resolving them
+    size_t samples = JF_MATH_MIN(pack->count, (size_t) JF_PACK_WINDOW_SAMPLES);
+    uint64_t total = 0;
+
+    for (size_t s = 0; s < samples; ++s) {
+        jf_PackRecord record;
+        size_t i = s * (pack->count - 1) / JF_MATH_MAX(samples - 1, (size_t) 1);
+        if (jf_pack_get(pack, i, &record) == JF_SUCCESS) { total += record.size; }
+    }
+
+    uint64_t resident = JF_MATH_MAX(total / samples, (uint64_t) 1) * JF_PACK_RESIDENT_FACTOR;
+    size_t window = (size_t) JF_MATH_MIN((uint64_t) pack->count, JF_MATH_MAX((uint64_t) budget / resident, (uint64_t) JF_PACK_WINDOW_MIN));
+
+    return window;
+}
+
+jf_Error jf_timeline_build_from_pack(jf_Timeline** timeline, jf_TimelineContext** context, const char* path, const jf_DiffCache* cache, jf_InternTable* strings) {
+    return jf_timeline_build_from_pack_range(timeline, context, path, 0, SIZE_MAX, cache, strings);
+}
+
+jf_Error jf_timeline_build_from_pack_range(jf_Timeline** timeline, jf_TimelineContext** context, const char* path, size_t first, size_t count, const jf_DiffCache* cache, jf_InternTable* strings) {
+    if (!timeline || !context || !path) { return JF_NO_REF; }
+
+    jf_Error err;
+    jf_Pack* pack = NULL;
+
+    *timeline = NULL;
+    *context = NULL;
+
+    if (err = jf_pack_open(&pack, path)) { return err; }
+    if (pack->count == 0) { return jf_pack_close(pack); }
+
+    if (first >= pack->count) {
+        jf_pack_close(pack);
+        return JF_INDEX_OUT_OF_BOUNDS;
+    }
+
+    count = JF_MATH_MIN(count, pack->count - first);
+
+    if (err = jf_timeline_context_alloc(context, count)) {
+        jf_pack_close(pack);
+        return err;
+    }
+
+    (*context)->first = first;
+
+    // nodes borrow their strings from the snapshots, the context closes them after the nodes are gone
+    jf_Pack* snapshots = NULL;
+    std::string snapshot_path = jf_pack_snapshot_path(path);
+
+    if (jf_pack_open(&snapshots, snapshot_path.c_str()) == JF_SUCCESS) {
+        (*context)->backing = snapshots;
+        (*context)->backing_free = jf_pack_close_backing;
+    }
+
+    // start paging in whatever gets read, workers load records in order as they arrive. a window
+    // of a long history is left to fault in on its own, it is only a sliver of the file
+    if (first == 0 && count == pack->count) {
+        if (snapshots) { jf_file_map_prefetch(&snapshots->map, 0, snapshots->data_end); }
+        if (!snapshots || snapshots->count < pack->count) { jf_file_map_prefetch(&pack->map, 0, pack->data_end); }
+    }
+
+    // the version before the window, only there as the other side of the first diff
+    if (first > 0) {
+        err = jf_pack_load_node(pack, snapshots, first - 1, &(*context)->base, JF_TRUE);
+        if (!err && strings) { err = jf_intern_node(strings, (*context)->base); }
+
+        if (err) {
+            jf_pack_close(pack);
+            jf_timeline_context_free(*context);
+            *context = NULL;
+            return err;
+        }
+    }
+
+    std::atomic<int> parse_err(JF_SUCCESS);
+    jf_parallel_for(count, [&](size_t i) {
+        jf_Error e;
+        char id[JF_STRING_MAX_NUMBER];
+
+        if (parse_err != JF_SUCCESS) { return; }
+
+        size_t len = jf_number_format_u64(id, pack->index[first + i].id);
+        if (e = jf_string_alloc(&(*context)->files[i], id, len))                               { parse_err = e; return; }
+        if (e = jf_pack_load_node(pack, snapshots, first + i, &(*context)->nodes[i], JF_TRUE)) { parse_err = e; return; }
+        if (strings && (e = jf_intern_node(strings, (*context)->nodes[i])))                    { parse_err = e; return; }
+    });
+
+    err = (jf_Error) parse_err.load();
+
+    jf_pack_close(pack);
+
+    // versions load on their own, what they have in common is shared once they are all in. in
+    // order, so a subtree that stays the same across many versions ends up as a single node
+    for (size_t i = 0; !err && i < count; ++i) {
+        jf_Node* prev = i > 0 ? (*context)->nodes[i - 1] : (*context)->base;
+        if (prev) { err = jf_node_share((*context)->nodes[i], prev); }
+    }
+
+    // each version is hashed once, its hash keys the diffs on either side of it
+    std::vector<uint64_t> hashes;
+    std::vector<uint8_t> cached;
+
+    if (!err && cache) {
+        hashes.resize(count + 1);
+        cached.resize(count, 0);
+
+        hashes[0] = (*context)->base ? jf_node_hash((*context)->base) : 0;
+        jf_parallel_for(count, [&](size_t i) { hashes[i + 1] = jf_node_hash((*context)->nodes[i]); });
+
+        // a miss, or an entry that doesn't fit these versions, is computed as if there were no cache
+        jf_parallel_for(count, [&](size_t i) {
+            jf_Node* a;
+            jf_Node* b;
+            jf_pack_diff_sides(*context, i, &a, &b);
+            cached[i] = jf_diff_cache_load(cache, jf_pack_diff_key(*context, hashes, i), a, b, &(*context)->diffs[i]) == JF_SUCCESS;
+        });
+    }
+
+    if (!err) { err = jf_timeline_build_from_nodes(timeline, *context); }
+
+    if (!err && cache) {
+        // the same pair of versions can come up more than once, each is only written once
+        std::vector<size_t> missed;
+        std::set<std::pair<uint64_t, uint64_t>> seen;
+
+        for (size_t i = 0; i < cached.size(); ++i) {
+            if (cached[i]) { continue; }
+
+            jf_DiffKey key = jf_pack_diff_key(*context, hashes, i);
+            if (!seen.insert({ key.hash_a, key.hash_b }).second) { continue; }
+            missed.push_back(i);
+        }
+
+        jf_parallel_for(missed.size(), [&](size_t m) {
+            size_t i = missed[m];
+            jf_Node* a;
+            jf_Node* b;
+            jf_pack_diff_sides(*context, i, &a, &b);
+            jf_diff_cache_store(cache, jf_pack_diff_key(*context, hashes, i), (*context)->diffs[i], a, b);
+        });
+
+        if (!missed.empty()) { jf_diff_cache_trim(cache); }
+    }
+
+    if (err) {
+        if (*timeline) { jf_timeline_free(*timeline); }
+        jf_timeline_context_free(*context);
+        *timeline = NULL;
+        *context = NULL;
+    }
+
+    return err;
+}
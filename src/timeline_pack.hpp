@@ -0,0 +1,164 @@
+#ifndef _TIMELINE_PACK_HPP
+#define _TIMELINE_PACK_HPP
+
+#include "jf.h"
+#include "file_map.hpp"
+#include "diff_cache.hpp"
+#include "string_intern.hpp"
+#include <stdint.h>
+
+/*
+    timeline pack - one append only file per timeline
+
+    [header] [record 0] [record 1] ... [record n] [index] [trailer]
+
+    records are framed and padded to 8 bytes, the index holds one entry per record
+    and the trailer sits at the very end of the file so version N is found in O(1).
+    the index + trailer are rewritten on every append, if they are missing or
+    damaged the records are recovered by scanning forward from the header.
+
+    record ids are version timestamps, in nanoseconds for new captures and seconds
+    for older ones, and the index is kept in increasing id order.
+
+    a snapshot that is byte for byte identical to an earlier one is stored as a
+    small reference record pointing at the earlier payload. index entries carry the
+    content hash that makes finding those cheap.
+
+    every version also gets a node snapshot (node_snapshot.hpp) in a second pack next
+    to it, under the same id. loading a version maps its snapshot instead of parsing
+    the json, versions without one (seeds, legacy imports) are still parsed.
+*/
+
+#define JF_PACK_FILE_NAME       "timeline.jfp"
+#define JF_PACK_SNAPSHOT_NAME   "timeline.jfs"
+#define JF_PACK_FORMAT_VERSION  2 // 2 added reference records + hashed index entries
+#define JF_PACK_MAGIC           0x4b50464a // "JFPK"
+#define JF_PACK_RECORD_MAGIC    0x5256464a // "JFVR"
+#define JF_PACK_INDEX_MAGIC     0x5849464a // "JFIX"
+#define JF_PACK_ALIGN           8
+
+// a version takes roughly this many times its json size once parsed and diffed against the one before it
+#define JF_PACK_RESIDENT_FACTOR 10
+#define JF_PACK_WINDOW_SAMPLES  64
+#define JF_PACK_WINDOW_MIN      8
+
+enum jf_PackEncoding {
+    JF_PACK_JSON, // raw json text as captured
+    JF_PACK_REF,  // u64 offset of an earlier record with the same payload
+    JF_PACK_NODE, // jf_Snapshot of the parsed json
+};
+
+struct jf_PackHeader {
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct jf_PackRecordHeader {
+    uint32_t magic;
+    uint32_t encoding;
+    uint64_t id;
+    uint64_t size;
+};
+
+struct jf_PackIndexEntry {
+    uint64_t offset; // offset of the record header
+    uint64_t id;
+    uint64_t hash;   // jf_hash_bytes of the payload, after following references
+};
+
+struct jf_PackTrailer {
+    uint64_t index_offset;
+    uint64_t count;
+    uint32_t magic;
+    uint32_t entry_size;
+};
+
+// references are resolved, data always points at the actual payload
+struct jf_PackRecord {
+    uint64_t id;
+    jf_PackEncoding encoding;
+    const char* data;
+    size_t size;
+};
+
+/*
+    read side, the whole pack is a single mapping
+*/
+struct jf_Pack {
+    jf_FileMap map;
+
+    size_t count;
+    size_t data_end;          // end of the last valid record
+    jf_Bool index_owned;      // index was rebuilt by a recovery scan
+    const jf_PackIndexEntry* index;
+};
+
+jf_Error jf_pack_open(jf_Pack** pack, const char* path);
+
+jf_Error jf_pack_close(jf_Pack* pack);
+
+jf_Error jf_pack_get(const jf_Pack* pack, size_t index, jf_PackRecord* record);
+
+// index of the record with id, JF_INDEX_OUT_OF_BOUNDS if there is none
+jf_Error jf_pack_find(const jf_Pack* pack, uint64_t id, size_t* index);
+
+// record index of pack as a node, thawed from its snapshot in snapshots when it has one and parsed otherwise.
+// with borrow the node's strings point into snapshots, which then has to stay open for as long as the node does
+jf_Error jf_pack_load_node(const jf_Pack* pack, const jf_Pack* snapshots, size_t index, jf_Node** node, jf_Bool borrow);
+
+/*
+    write side, records are appended where the old index was, the index is written back on close
+*/
+struct jf_PackWriter {
+    FILE* file;
+
+    size_t count;
+    size_t capacity;
+    size_t data_end;
+    jf_PackIndexEntry* index;
+};
+
+// nanoseconds since the unix epoch, strictly increasing across calls so captures in the same tick never collide
+uint64_t jf_pack_next_id();
+
+jf_Error jf_pack_writer_open(jf_PackWriter** writer, const char* path);
+
+// an id at or below the last one in the pack is moved up to keep ids increasing,
+// a payload the pack already holds is written as a reference to it
+jf_Error jf_pack_writer_append(jf_PackWriter* writer, uint64_t id, jf_PackEncoding encoding, const char* data, size_t size);
+
+// appends the contents of a file, copied inside the kernel where the platform allows it
+jf_Error jf_pack_writer_append_file(jf_PackWriter* writer, uint64_t id, jf_PackEncoding encoding, const char* src_path);
+
+// index of the record with id among the ones the pack already had and the ones appended since,
+// JF_INDEX_OUT_OF_BOUNDS if there is none
+jf_Error jf_pack_writer_find_id(const jf_PackWriter* writer, uint64_t id, size_t* index);
+
+jf_Error jf_pack_writer_close(jf_PackWriter* writer);
+
+// single record convenience wrapper, stored_id receives the id the record actually got
+jf_Error jf_pack_append(const char* path, uint64_t id, jf_PackEncoding encoding, const char* data, size_t size, uint64_t* stored_id = NULL);
+
+// snapshots every record of the pack at path that its snapshot pack doesn't hold yet
+jf_Error jf_pack_write_snapshots(const char* path);
+
+// writes record index of the pack at path back to dest_path, atomically, and appends it again as the pack's newest
+// record, stored_id receives its id. the new record and its snapshot are references to the old ones, nothing is parsed
+jf_Error jf_pack_restore(const char* path, size_t index, const char* dest_path, uint64_t* stored_id = NULL);
+
+// folds the loose <id>.json files of a legacy .tml folder into its pack
+jf_Error jf_pack_import_legacy(const char* folder);
+
+// loads every record of the pack at path into a new context + timeline, the context keeps the snapshots mapped.
+// with a cache, diffs it holds are read instead of computed and the ones it didn't are added to it. with a
+// string table, every version is interned into it, which then has to outlive the context
+jf_Error jf_timeline_build_from_pack(jf_Timeline** timeline, jf_TimelineContext** context, const char* path, const jf_DiffCache* cache = NULL, jf_InternTable* strings = NULL);
+
+// the same for versions [first, first + count) only, plus the version before first as the context's base.
+// every version is stored whole, so any window costs the same no matter how deep in the history it is
+jf_Error jf_timeline_build_from_pack_range(jf_Timeline** timeline, jf_TimelineContext** context, const char* path, size_t first, size_t count, const jf_DiffCache* cache = NULL, jf_InternTable* strings = NULL);
+
+// how many versions of the pack fit in budget bytes once loaded, never fewer than JF_PACK_WINDOW_MIN
+size_t jf_pack_window_size(const jf_Pack* pack, size_t budget);
+
+#endif